@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////
 //  DepAnal.h - analyze dependency relationships between files     //
-//  ver 1.1                                                        //
+//  ver 1.7                                                        //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform code dependency analysis        //
@@ -11,7 +11,6 @@
 #include "DepAnal.h"
 #include <string>
 #include <functional>
-#include "../Tokenizer/Tokenizer.h"
 #include "../FileSystem/FileSystem.h"
 
 using namespace CodeAnalysis;
@@ -60,6 +59,14 @@ void DepAnal::distTypes(std::unordered_set<std::string>& tokens, std::string fil
   } // end for
 }
 
+//----< collect the identifiers of a file >------------------------
+
+bool DepAnal::scanTokens(const File& file, DepCache::Tokens& tokens)
+{
+  TokenCache::Entry entry;
+  return TokenCache::scan(file, entry, tokens);
+}
+
 //----< do analyze dependencies >-----------------------------------
 
 void DepAnal::doDepAnal()
@@ -72,35 +79,212 @@ void DepAnal::doDepAnal()
   {
     for (auto file : item.second)
     {
-      std::ifstream in(file);
-      if (!in.good())
-      {
-        std::cout << "\n  can't open " << file << "\n\n";
-        continue;
-      }
-
-      Scanner::Toker toker;
-      toker.returnComments(false);
-      toker.attach(&in);
-
       std::unordered_set<std::string> tokens;
-      do
-      {
-        std::string tok = toker.getTok();
-        // add tokens to unordered_set
-        tokens.insert(tok);
-      } while (in.good());
-
-      // close file
-      in.close();
+      TokenCache::Entry entry;
+      if (!TokenCache::scan(file, entry, tokens))
+        continue;
 
       distTypes(tokens, file);
+      std::string relFile = FileSystem::Path::getRelativeFromPathToFile(path_, file);
+      cache_.setTokens(relFile, tokens);
+      if (keepSources_)
+        tokenCache_.add(relFile, std::move(entry));
     } // end for
   } // end for
 
+  // keep types for later incremental updates
+  cache_.setPath(path_);
+  for (auto iter = TTref_.begin(); iter != TTref_.end(); iter++)
+    cache_.addType(*iter);
+
   std::cout << "\n    scanning completed!\n";
 }
 
+/////////////////////////////////////////////////////////////////////
+// TokenFilter class members
+
+//----< build filter sized for the number of tokens >---------------
+
+TokenFilter::TokenFilter(const Tokens& tokens)
+{
+  size_t numBits = tokens.size() * BitsPerToken;
+  size_t wordBits = 8 * sizeof(Word);
+  bits_.assign(numBits / wordBits + 1, 0);
+  numBits = bits_.size() * wordBits;
+
+  for (auto& token : tokens)
+  {
+    Word h = hash(token);
+    Word h1 = h & 0xffffffff, h2 = (h >> 32) | 1;
+    for (size_t i = 0; i < NumHashes; ++i)
+    {
+      size_t bit = static_cast<size_t>((h1 + i * h2) % numBits);
+      bits_[bit / wordBits] |= (Word(1) << (bit % wordBits));
+    }
+  }
+}
+
+//----< may the filter's token set hold this token? >---------------
+
+bool TokenFilter::mayContain(const std::string& token) const
+{
+  if (bits_.empty())
+    return false;
+
+  size_t wordBits = 8 * sizeof(Word);
+  size_t numBits = bits_.size() * wordBits;
+  Word h = hash(token);
+  Word h1 = h & 0xffffffff, h2 = (h >> 32) | 1;
+  for (size_t i = 0; i < NumHashes; ++i)
+  {
+    size_t bit = static_cast<size_t>((h1 + i * h2) % numBits);
+    if (!(bits_[bit / wordBits] & (Word(1) << (bit % wordBits))))
+      return false;
+  }
+  return true;
+}
+
+//----< 64 bit FNV-1a hash, same on 32 and 64 bit builds >----------
+
+TokenFilter::Word TokenFilter::hash(const std::string& token)
+{
+  Word h = 14695981039346656037ULL;
+  for (unsigned char ch : token)
+  {
+    h ^= ch;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/////////////////////////////////////////////////////////////////////
+// DepCache class members
+
+//----< does a token set use a type? >------------------------------
+/*
+* same test as DepAnal::distTypes: type name found and either a
+* global type or its namespace found too
+*/
+bool DepCache::uses(const Tokens& tokens, TypeElement& type)
+{
+  if (tokens.find(type.name()) == tokens.end())
+    return false;
+  return type.getNamespace() == "Global Namespace" ||
+    tokens.find(type.getNamespace()) != tokens.end();
+}
+
+//----< may a filtered token set use a type? >-----------------------
+
+bool DepCache::mayUse(const TokenFilter& filter, TypeElement& type)
+{
+  if (!filter.mayContain(type.name()))
+    return false;
+  return type.getNamespace() == "Global Namespace" ||
+    filter.mayContain(type.getNamespace());
+}
+
+//----< may a filtered token set use any of types? >----------------
+
+bool DepCache::mayUseAny(const TokenFilter& filter, Types& types)
+{
+  for (auto& type : types)
+  {
+    if (mayUse(filter, type))
+      return true;
+  }
+  return false;
+}
+
+//----< rescan the cached files that may use types of file >---------
+/*
+* Files whose filter can't hold any of the type names are skipped
+* without reading them. Candidates are rescanned, to rule out false
+* positives of the filter, before the cache is changed, so a caller
+* can do the reads without holding any lock.
+*/
+DepCache::Scans DepCache::scanUsers(const File& file, Types& types) const
+{
+  Scans users;
+  for (auto& item : filters_)
+  {
+    if (item.first == file || !mayUseAny(item.second, types))
+      continue;
+    Tokens tokens;
+    if (DepAnal::scanTokens(FileSystem::Path::getAbsoluteFileSpec(item.first, path_), tokens))
+      users[item.first] = std::move(tokens);
+  }
+  return users;
+}
+
+//----< re-analyze one added or changed file >-----------------------
+/*
+* - recomputes the file's own dependencies from its new tokens
+* - recomputes which files depend on the file, from the types the
+*   file now defines: files whose filter can't hold them don't, and
+*   rescanned users do if their tokens use one. A candidate missing
+*   from users, e.g., one that changed since the scan, keeps its edge.
+*/
+void DepCache::updateFile(DepTable& depTable, const File& file, const Tokens& tokens, const Types& types, const Scans& users)
+{
+  filters_[file] = TokenFilter(tokens);
+  types_[file] = types;
+
+  // outgoing edges
+  depTable.addFile(file);
+  depTable.clearDepFiles(file);
+  for (auto& item : types_)
+  {
+    if (item.first == file)
+      continue;
+    for (auto& type : item.second)
+    {
+      if (uses(tokens, type))
+      {
+        depTable.addDepFile(file, item.first);
+        break;
+      }
+    }
+  }
+
+  // incoming edges
+  Types& defined = types_[file];
+  for (auto& item : filters_)
+  {
+    if (item.first == file)
+      continue;
+    if (!mayUseAny(item.second, defined))
+    {
+      depTable.removeDepFile(item.first, file);
+      continue;
+    }
+    auto scanned = users.find(item.first);
+    if (scanned == users.end())
+      continue;
+    bool used = false;
+    for (auto& type : defined)
+    {
+      if (uses(scanned->second, type))
+      {
+        used = true;
+        break;
+      }
+    }
+    if (used)
+      depTable.addDepFile(item.first, file);
+    else
+      depTable.removeDepFile(item.first, file);
+  }
+}
+
+//----< forget a deleted file >--------------------------------------
+
+void DepCache::removeFile(DepTable& depTable, const File& file)
+{
+  filters_.erase(file);
+  types_.erase(file);
+  depTable.removeFile(file);
+}
+
 //----< Test Stub >--------------------------------------------------
 
 #ifdef TEST_DEPANAL
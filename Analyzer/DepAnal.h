@@ -1,7 +1,7 @@
 #pragma once
 /////////////////////////////////////////////////////////////////////
 //  DepAnal.h - analyze dependency relationships between files     //
-//  ver 1.1                                                        //
+//  ver 1.7                                                        //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform code dependency analysis        //
@@ -17,17 +17,35 @@ This package defines a TypeAnal class to find, for each file in a
 specified file collection, all other files from the file collection on
 which they depend.
 This class ckeck if a file contains tokens in the type table.
+It also defines a DepCache class that keeps the tokens and types of
+every analyzed file, so the DepTable can be patched when one file is
+uploaded, re-uploaded or deleted, without a full re-analysis.
+Tokens are kept as a TokenFilter, a Bloom filter of about ten bits
+per distinct token. When types change, only files whose filter may
+hold a type name are rescanned to confirm the dependency. scanUsers
+does those reads up front, against a cache that isn't being changed,
+so updateFile itself reads no files.
+Files are lexed by TokenCache, once each. With keepSources set, the
+sources and token spans are kept in a TokenCache, so the publisher
+doesn't have to read the files again.
 
 Public Interface:
 =================
 DepAnal depAnal(fileMap);       // create an instance with filemap
+depAnal.keepSources(true);      // keep sources and token spans
 depAnal.doDepAnal();            // do analyze dependencies
+TokenCache& tokens = depAnal.tokenCache();      // sources and spans of last analysis
+DepCache cache = depAnal.cache();               // tokens and types of last analysis
+DepCache::Scans users = cache.scanUsers(file, types);  // rescan possible users
+cache.updateFile(depTable, file, tokens, types, users); // patch edges of one file
+cache.removeFile(depTable, file);               // drop file and its edges
 
 Build Process:
 ==============
 Required files
 - TypeAnal.h, TypeAnal.cpp
 - DepAnal.h, DepAnal.cpp
+- TokenCache.h, TokenCache.cpp
 - Tokenizer.h, Tokenizer.cpp
 - ActionsAndRules.h, ActionsAndRules.cpp
 - Parser.h, Parser.cpp
@@ -38,6 +56,20 @@ Required files
 
 Maintenance History:
 ====================
+ver 1.7 : 19 Oct 2026
+- DepCache::scanUsers rescans the files that may use a file's types,
+  updateFile takes the result instead of reading them itself
+ver 1.6 : 19 Oct 2026
+- added DepTable::depCount, counting dependencies without a copy
+ver 1.5 : 19 Oct 2026
+- DepTable queries and iteration work on a const DepTable
+ver 1.4 : 19 Oct 2026
+- files are lexed by TokenCache, sources and spans can be kept
+ver 1.3 : 19 Oct 2026
+- DepCache keeps per-file Bloom filters instead of token sets
+ver 1.2 : 19 Oct 2026
+- added DepCache for incremental maintenance of the DepTable
+- added DepTable operations to remove files and dependencies
 ver 1.1 : 28 Mar 2017
 - removed NoSqlDb, use a simple data structure to store dependencies
 ver 1.0 : 13 Mar 2017
@@ -50,6 +82,7 @@ ver 1.0 : 13 Mar 2017
 #include <unordered_set>
 #include <unordered_map>
 #include "../Parser/ActionsAndRules.h"
+#include "TokenCache.h"
 
 namespace CodeAnalysis
 {
@@ -60,14 +93,22 @@ namespace CodeAnalysis
     using Deps = std::unordered_set<File>;
     using Item = std::pair<File, Deps>;
     using iterator = typename std::unordered_map<File, Deps>::iterator;
+    using const_iterator = typename std::unordered_map<File, Deps>::const_iterator;
 
     void addFile(File parent);
     void addDepFile(File parent, File child);
-    Deps getDepFiles(File parent);
+    void removeFile(File file);
+    void removeDepFile(File parent, File child);
+    void clearDepFiles(File parent);
+    bool contains(File file) const { return _store.find(file) != _store.end(); }
+    Deps getDepFiles(File parent) const;
+    size_t depCount(const File& parent) const;
 
-    const size_t size() { return _store.size(); }
+    const size_t size() const { return _store.size(); }
     iterator begin() { return _store.begin(); }
     iterator end() { return _store.end(); }
+    const_iterator begin() const { return _store.begin(); }
+    const_iterator end() const { return _store.end(); }
 
   private:
     std::unordered_map<File, Deps> _store;
@@ -99,11 +140,41 @@ namespace CodeAnalysis
     }
   }
 
-  inline DepTable::Deps DepTable::getDepFiles(File parent)
+  //----< remove a file and every dependency on it >----------------
+
+  inline void DepTable::removeFile(File file)
   {
-    if (_store.find(parent) != _store.end())
+    _store.erase(file);
+    for (auto& item : _store)
+      item.second.erase(file);
+  }
+
+  inline void DepTable::removeDepFile(File parent, File child)
+  {
+    auto iter = _store.find(parent);
+    if (iter != _store.end())
+      iter->second.erase(child);
+  }
+
+  inline void DepTable::clearDepFiles(File parent)
+  {
+    auto iter = _store.find(parent);
+    if (iter != _store.end())
+      iter->second.clear();
+  }
+
+  inline size_t DepTable::depCount(const File& parent) const
+  {
+    auto iter = _store.find(parent);
+    return iter == _store.end() ? 0 : iter->second.size();
+  }
+
+  inline DepTable::Deps DepTable::getDepFiles(File parent) const
+  {
+    auto iter = _store.find(parent);
+    if (iter != _store.end())
     {
-      return _store[parent];
+      return iter->second;
     }
     else
     {
@@ -112,6 +183,61 @@ namespace CodeAnalysis
     }
   }
 
+  ///////////////////////////////////////////////////////////////////
+  // TokenFilter class is a Bloom filter over the tokens of a file
+  // - mayContain never answers false for a token that was added
+
+  class TokenFilter
+  {
+  public:
+    using Tokens = std::unordered_set<std::string>;
+
+    TokenFilter() {}
+    TokenFilter(const Tokens& tokens);
+    bool mayContain(const std::string& token) const;
+    size_t bytes() const { return bits_.size() * sizeof(Word); }
+
+  private:
+    using Word = unsigned long long;
+    static const size_t BitsPerToken = 10;
+    static const size_t NumHashes = 7;
+    static Word hash(const std::string& token);
+
+    std::vector<Word> bits_;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  // DepCache class keeps tokens and types of each analyzed file
+  // - files are stored by path relative to the analysis path,
+  //   the same way DepTable stores them
+
+  class DepCache
+  {
+  public:
+    using Path = std::string;
+    using File = std::string;
+    using Tokens = std::unordered_set<std::string>;
+    using Types = std::vector<TypeElement>;
+    using Scans = std::unordered_map<File, Tokens>;
+
+    void setPath(const Path& analysisPath) { path_ = analysisPath; }
+    void setTokens(const File& file, const Tokens& tokens) { filters_[file] = TokenFilter(tokens); }
+    void addType(const TypeElement& type) { types_[type.path()].push_back(type); }
+    Scans scanUsers(const File& file, Types& types) const;
+    void updateFile(DepTable& depTable, const File& file, const Tokens& tokens, const Types& types, const Scans& users);
+    void removeFile(DepTable& depTable, const File& file);
+    size_t size() { return filters_.size(); }
+
+  private:
+    static bool uses(const Tokens& tokens, TypeElement& type);
+    static bool mayUse(const TokenFilter& filter, TypeElement& type);
+    static bool mayUseAny(const TokenFilter& filter, Types& types);
+
+    Path path_;
+    std::unordered_map<File, TokenFilter> filters_;
+    std::unordered_map<File, Types> types_;
+  };
+
   ///////////////////////////////////////////////////////////////////
   // DepAnal class do dependencies analysis of source code files
 
@@ -128,11 +254,19 @@ namespace CodeAnalysis
     void doDepAnal();
     void initDepTable();
     DepTable& depTable() { return depTable_; }
+    DepCache& cache() { return cache_; }
+    void keepSources(bool keep) { keepSources_ = keep; }
+    TokenCache& tokenCache() { return tokenCache_; }
+
+    static bool scanTokens(const File& file, DepCache::Tokens& tokens);
 
   private:
     TypeTable& TTref_;
     FileMap& fileMap_;
     DepTable depTable_;
+    DepCache cache_;
+    TokenCache tokenCache_;
+    bool keepSources_;
     Path path_;
 
     void distTypes(std::unordered_set<std::string>& tokens, std::string file);
@@ -143,6 +277,7 @@ namespace CodeAnalysis
   inline DepAnal::DepAnal(FileMap& fileMap, Path analysisPath) :
     TTref_(Repository::getInstance()->getTypeTable()),
     fileMap_(fileMap),
+    keepSources_(false),
     path_(analysisPath)
   {
   }
@@ -0,0 +1,305 @@
+/////////////////////////////////////////////////////////////////////
+//  DepGraph.cpp - condensed dependency graph with cached closures //
+//  ver 1.1                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to perform remote code publisher           //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+
+#include "DepGraph.h"
+#include <algorithm>
+
+using namespace CodeAnalysis;
+
+//----< get node of a file, adding it if not seen before >-----------
+
+DepGraph::Node DepGraph::addNode(const File& file)
+{
+  auto iter = index_.find(file);
+  if (iter != index_.end())
+    return iter->second;
+
+  Node node = files_.size();
+  index_[file] = node;
+  files_.push_back(file);
+  edges_.push_back(Nodes());
+  return node;
+}
+
+//----< build components and closures from dependency table >--------
+
+void DepGraph::build(DepTable& depTable)
+{
+  index_.clear();
+  files_.clear();
+  edges_.clear();
+
+  // add parents first so every file in the table has a node
+  for (auto item : depTable)
+    addNode(item.first);
+
+  for (auto item : depTable)
+  {
+    Node parent = index_[item.first];
+    for (auto child : item.second)
+    {
+      Node node = addNode(child);
+      edges_[parent].push_back(node);
+    }
+  }
+
+  findComponents();
+  condense();
+}
+
+//----< find strongly connected components with Tarjan's algorithm >-
+/*
+* Uses an explicit work stack instead of recursion, so long include
+* chains can't overflow the call stack. Components are numbered in
+* the order they complete, which means every component a component
+* depends on has a smaller number.
+*/
+void DepGraph::findComponents()
+{
+  const Node unvisited = static_cast<Node>(-1);
+  size_t numNodes = files_.size();
+
+  Nodes order(numNodes, unvisited);
+  Nodes low(numNodes, 0);
+  std::vector<bool> onStack(numNodes, false);
+  Nodes stack;
+  std::vector<std::pair<Node, size_t>> work;  // node and index of next edge
+  size_t counter = 0;
+
+  component_.assign(numNodes, unvisited);
+  members_.clear();
+
+  auto visit = [&](Node node) {
+    order[node] = low[node] = counter++;
+    stack.push_back(node);
+    onStack[node] = true;
+    work.push_back(std::make_pair(node, 0));
+  };
+
+  for (Node root = 0; root < numNodes; ++root)
+  {
+    if (order[root] != unvisited)
+      continue;
+
+    visit(root);
+    while (!work.empty())
+    {
+      Node node = work.back().first;
+      size_t next = work.back().second;
+
+      if (next < edges_[node].size())
+      {
+        ++work.back().second;
+        Node child = edges_[node][next];
+        if (order[child] == unvisited)
+          visit(child);
+        else if (onStack[child])
+          low[node] = (std::min)(low[node], order[child]);
+        continue;
+      }
+
+      // all edges of node are done
+      work.pop_back();
+      if (!work.empty())
+      {
+        Node parent = work.back().first;
+        low[parent] = (std::min)(low[parent], low[node]);
+      }
+
+      if (low[node] == order[node])
+      {
+        Nodes members;
+        Node member;
+        do
+        {
+          member = stack.back();
+          stack.pop_back();
+          onStack[member] = false;
+          component_[member] = members_.size();
+          members.push_back(member);
+        } while (member != node);
+        members_.push_back(members);
+      }
+    }
+  }
+}
+
+//----< build condensed DAG and closure of every component >---------
+
+void DepGraph::condense()
+{
+  const Node unmarked = static_cast<Node>(-1);
+  size_t numComps = members_.size();
+
+  dag_.assign(numComps, Nodes());
+  rdag_.assign(numComps, Nodes());
+  closure_.assign(numComps, Nodes());
+  Nodes mark(numComps, unmarked);
+
+  for (Node comp = 0; comp < numComps; ++comp)
+  {
+    // edges leaving the component, without duplicates
+    mark[comp] = comp;
+    for (auto member : members_[comp])
+    {
+      for (auto child : edges_[member])
+      {
+        Node target = component_[child];
+        if (mark[target] != comp)
+        {
+          mark[target] = comp;
+          dag_[comp].push_back(target);
+          rdag_[target].push_back(comp);
+        }
+      }
+    }
+  }
+
+  // children always have smaller numbers, so their closures are ready
+  mark.assign(numComps, unmarked);
+  for (Node comp = 0; comp < numComps; ++comp)
+  {
+    Nodes& closure = closure_[comp];
+    closure.push_back(comp);
+    mark[comp] = comp;
+    for (auto child : dag_[comp])
+    {
+      for (auto reached : closure_[child])
+      {
+        if (mark[reached] != comp)
+        {
+          mark[reached] = comp;
+          closure.push_back(reached);
+        }
+      }
+    }
+  }
+}
+
+//----< get file and all files it transitively depends on >----------
+/*
+* The file itself is always the first element of the result. A file
+* that is not in the graph is returned alone.
+*/
+DepGraph::Files DepGraph::connectedFiles(const File& file) const
+{
+  Files files;
+  files.push_back(file);
+
+  auto iter = index_.find(file);
+  if (iter == index_.end())
+    return files;
+
+  Node self = iter->second;
+  for (auto comp : closure_[component_[self]])
+  {
+    for (auto member : members_[comp])
+    {
+      if (member != self)
+        files.push_back(files_[member]);
+    }
+  }
+  return files;
+}
+
+//----< get all files that transitively depend on file >------------
+/*
+* Walks the reverse edges of the condensed DAG. Other members of the
+* file's own component are included since they reach it through the
+* cycle. The file itself is not part of the result.
+*/
+DepGraph::Files DepGraph::dependentFiles(const File& file) const
+{
+  Files files;
+  auto iter = index_.find(file);
+  if (iter == index_.end())
+    return files;
+
+  Node self = iter->second;
+  Node start = component_[self];
+  std::vector<bool> visited(members_.size(), false);
+  Nodes pending;
+  pending.push_back(start);
+  visited[start] = true;
+
+  while (!pending.empty())
+  {
+    Node comp = pending.back();
+    pending.pop_back();
+    for (auto member : members_[comp])
+    {
+      if (member != self)
+        files.push_back(files_[member]);
+    }
+    for (auto parent : rdag_[comp])
+    {
+      if (!visited[parent])
+      {
+        visited[parent] = true;
+        pending.push_back(parent);
+      }
+    }
+  }
+  return files;
+}
+
+//----< show components with more than one file >--------------------
+
+void DepGraph::show(std::ostream& out) const
+{
+  out << "\n    files: " << numFiles() << ", components: " << numComponents();
+  for (size_t comp = 0; comp < members_.size(); ++comp)
+  {
+    if (members_[comp].size() < 2)
+      continue;
+    out << "\n    component " << comp << ":";
+    for (auto member : members_[comp])
+      out << "\n      " << files_[member];
+  }
+  out << "\n";
+}
+
+//----< Test Stub >--------------------------------------------------
+
+#ifdef TEST_DEPGRAPH
+
+#include "../Utilities/Utilities.h"
+
+int main()
+{
+  Utilities::StringHelper::Title("Testing DepGraph Class");
+  Utilities::putline();
+
+  DepTable table;
+  table.addDepFile(".\\a.cpp", ".\\a.h");
+  table.addDepFile(".\\a.h", ".\\b.h");
+  table.addDepFile(".\\b.h", ".\\c.h");
+  table.addDepFile(".\\c.h", ".\\b.h");  // b.h and c.h form a cycle
+  table.addDepFile(".\\c.h", ".\\d.h");
+  table.addFile(".\\e.h");
+
+  DepGraph graph;
+  graph.build(table);
+  graph.show();
+
+  std::vector<std::string> tests = { ".\\a.cpp", ".\\c.h", ".\\e.h", ".\\unknown.h" };
+  for (auto file : tests)
+  {
+    std::cout << "\n  connected to " << file << ":";
+    for (auto connected : graph.connectedFiles(file))
+      std::cout << " " << connected;
+    std::cout << "\n  depending on " << file << ":";
+    for (auto dependent : graph.dependentFiles(file))
+      std::cout << " " << dependent;
+  }
+  std::cout << "\n\n";
+}
+
+#endif
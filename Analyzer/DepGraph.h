@@ -0,0 +1,88 @@
+#pragma once
+/////////////////////////////////////////////////////////////////////
+//  DepGraph.h - condensed dependency graph with cached closures   //
+//  ver 1.1                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to perform remote code publisher           //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+/*
+Package Operations:
+==================
+This package defines a DepGraph class that is built from a DepTable
+after each dependency analysis.
+It finds the strongly connected components of the file dependency
+graph, condenses them into a DAG, and caches, for every component,
+the set of components reachable from it. All files in one component
+share the same closure, so finding every file a page needs is a
+lookup instead of a graph search.
+The DAG also keeps reverse edges to answer which files transitively
+depend on a given file, e.g., which pages a changed file affects.
+
+Public Interface:
+=================
+DepGraph graph;                             // create an empty graph
+graph.build(depTable);                      // condense a dependency table
+Files files = graph.connectedFiles(file);   // file and all files it needs
+Files users = graph.dependentFiles(file);   // all files that need file
+graph.show();                               // show components
+
+Build Process:
+==============
+Required files
+- DepGraph.h, DepGraph.cpp
+- DepAnal.h, DepAnal.cpp
+
+Maintenance History:
+====================
+ver 1.1 : 19 Oct 2026
+- added reverse edges and dependentFiles query
+ver 1.0 : 19 Oct 2026
+- first release
+
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "DepAnal.h"
+
+namespace CodeAnalysis
+{
+  ///////////////////////////////////////////////////////////////////
+  // DepGraph class stores strongly connected components of a DepTable
+
+  class DepGraph
+  {
+  public:
+    using File = std::string;
+    using Files = std::vector<File>;
+    using Node = size_t;
+    using Nodes = std::vector<Node>;
+
+    void build(DepTable& depTable);
+    Files connectedFiles(const File& file) const;
+    Files dependentFiles(const File& file) const;
+    bool contains(const File& file) const { return index_.find(file) != index_.end(); }
+    size_t numFiles() const { return files_.size(); }
+    size_t numComponents() const { return members_.size(); }
+    void show(std::ostream& out = std::cout) const;
+
+  private:
+    Node addNode(const File& file);
+    void findComponents();
+    void condense();
+
+    std::unordered_map<File, Node> index_;  // file name -> node
+    Files files_;                           // node -> file name
+    std::vector<Nodes> edges_;              // node -> nodes it depends on
+    Nodes component_;                       // node -> component
+    std::vector<Nodes> members_;            // component -> nodes
+    std::vector<Nodes> dag_;                // component -> components it depends on
+    std::vector<Nodes> rdag_;               // component -> components depending on it
+    std::vector<Nodes> closure_;            // component -> reachable components
+  };
+}
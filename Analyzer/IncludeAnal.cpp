@@ -0,0 +1,317 @@
+/////////////////////////////////////////////////////////////////////
+//  IncludeAnal.cpp - fast include-graph dependency analysis       //
+//  ver 1.1                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to perform code dependency analysis        //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+
+#include "IncludeAnal.h"
+#include <fstream>
+#include <cctype>
+#include <algorithm>
+#include "../FileSystem/FileSystem.h"
+
+using namespace CodeAnalysis;
+
+//----< read next identifier, possibly qualified, from a line >------
+
+static std::string nextWord(const std::string& line, size_t& pos)
+{
+  while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t'))
+    ++pos;
+  size_t start = pos;
+  while (pos < line.size() &&
+    (std::isalnum(static_cast<unsigned char>(line[pos])) || line[pos] == '_' || line[pos] == ':'))
+    ++pos;
+  return line.substr(start, pos - start);
+}
+
+//----< last part of a qualified name, e.g., B from A::B >-----------
+
+static std::string lastName(const std::string& name)
+{
+  size_t pos = name.find_last_of(':');
+  if (pos == std::string::npos)
+    return name;
+  return name.substr(pos + 1);
+}
+
+//----< IncludeAnal constructor, collect files to scan >-------------
+
+IncludeAnal::IncludeAnal(FileMap& fileMap, Path analysisPath) : path_(analysisPath)
+{
+  for (auto item : fileMap)
+  {
+    for (auto file : item.second)
+      sources_.push_back(file);
+  }
+}
+
+//----< scan one file for includes, usings and namespaces >----------
+/*
+* Works line by line. Lines starting inside a block comment are
+* skipped, as are #include <...> lines. Nothing else is tokenized.
+*/
+bool IncludeAnal::scanLines(const File& fqFile, Scan& scan)
+{
+  std::ifstream in(fqFile);
+  if (!in.good())
+  {
+    std::cout << "\n  can't open " << fqFile << "\n\n";
+    return false;
+  }
+
+  std::string line;
+  bool inComment = false;
+  while (std::getline(in, line))
+  {
+    size_t pos = 0;
+    if (inComment)
+    {
+      size_t end = line.find("*/");
+      if (end == std::string::npos)
+        continue;
+      inComment = false;
+      pos = end + 2;
+    }
+    pos = line.find_first_not_of(" \t", pos);
+    if (pos == std::string::npos)
+      continue;
+
+    if (line.compare(pos, 2, "/*") == 0)
+    {
+      if (line.find("*/", pos + 2) == std::string::npos)
+        inComment = true;
+      continue;
+    }
+
+    if (line[pos] == '#')
+    {
+      ++pos;
+      if (nextWord(line, pos) != "include")
+        continue;
+      size_t open = line.find('"', pos);
+      if (open == std::string::npos)
+        continue;
+      size_t close = line.find('"', open + 1);
+      if (close != std::string::npos)
+        scan.includes.push_back(line.substr(open + 1, close - open - 1));
+      continue;
+    }
+
+    std::string word = nextWord(line, pos);
+    if (word == "inline")
+      word = nextWord(line, pos);
+    if (word == "namespace")
+    {
+      std::string name = lastName(nextWord(line, pos));
+      if (name.size() > 0)
+        scan.namespaces.push_back(name);
+    }
+    else if (word == "using" && nextWord(line, pos) == "namespace")
+    {
+      std::string name = lastName(nextWord(line, pos));
+      if (name.size() > 0)
+        scan.usings.push_back(name);
+    }
+  }
+  in.close();
+  return true;
+}
+
+//----< lower case key, file names aren't case sensitive >----------
+
+std::string IncludeAnal::key(const std::string& name)
+{
+  std::string result = name;
+  std::replace(result.begin(), result.end(), '/', '\\');
+  return FileSystem::Path::toLower(result);
+}
+
+//----< remember a scanned file >-----------------------------------
+
+void IncludeAnal::addFile(const File& file, const Scan& scan)
+{
+  scans_[file] = scan;
+  files_[key(FileSystem::Path::getAbsoluteFileSpec(file, path_))] = file;
+  names_[key(FileSystem::Path::getName(file))].push_back(file);
+  for (auto name : scan.namespaces)
+    declared_[name].insert(file);
+}
+
+//----< forget a scanned file >-------------------------------------
+
+void IncludeAnal::dropFile(const File& file)
+{
+  auto iter = scans_.find(file);
+  if (iter == scans_.end())
+    return;
+
+  files_.erase(key(FileSystem::Path::getAbsoluteFileSpec(file, path_)));
+  Files& named = names_[key(FileSystem::Path::getName(file))];
+  named.erase(std::remove(named.begin(), named.end(), file), named.end());
+  for (auto name : iter->second.namespaces)
+    declared_[name].erase(file);
+  scans_.erase(iter);
+}
+
+//----< find repository file an include line refers to >-------------
+/*
+* Tries the path relative to the including file first. If that isn't
+* a repository file, falls back to the file name alone, but only when
+* a single repository file has that name.
+*/
+IncludeAnal::File IncludeAnal::resolve(const File& file, const File& include)
+{
+  std::string dir = FileSystem::Path::getPath(FileSystem::Path::getAbsoluteFileSpec(file, path_));
+  std::string fqInclude = FileSystem::Path::getFullFileSpec(dir + key(include));
+  auto iter = files_.find(key(fqInclude));
+  if (iter != files_.end())
+    return iter->second;
+
+  auto named = names_.find(key(FileSystem::Path::getName(key(include))));
+  if (named != names_.end() && named->second.size() == 1)
+    return named->second[0];
+  return "";
+}
+
+//----< recompute the dependencies of one scanned file >-------------
+
+void IncludeAnal::linkFile(DepTable& depTable, const File& file)
+{
+  depTable.addFile(file);
+  depTable.clearDepFiles(file);
+
+  Scan& scan = scans_[file];
+  for (auto include : scan.includes)
+  {
+    File child = resolve(file, include);
+    if (child.size() > 0)
+      depTable.addDepFile(file, child);
+  }
+  for (auto name : scan.usings)
+  {
+    auto iter = declared_.find(name);
+    if (iter == declared_.end())
+      continue;
+    for (auto child : iter->second)
+      depTable.addDepFile(file, child);
+  }
+}
+
+//----< could a scanned file depend on file? >-----------------------
+
+bool IncludeAnal::refersTo(const Scan& scan, const File& file, const Names& namespaces)
+{
+  std::string name = key(FileSystem::Path::getName(file));
+  for (auto include : scan.includes)
+  {
+    if (key(FileSystem::Path::getName(key(include))) == name)
+      return true;
+  }
+  for (auto used : scan.usings)
+  {
+    if (std::find(namespaces.begin(), namespaces.end(), used) != namespaces.end())
+      return true;
+  }
+  return false;
+}
+
+//----< scan all files, then resolve their includes and usings >-----
+
+void IncludeAnal::doIncludeAnal()
+{
+  std::cout << "\n    starting fast dependency analysis:\n";
+  std::cout << "\n    scanning include lines and using directives:";
+  std::cout << "\n    --------------------------------------------";
+
+  for (auto fqFile : sources_)
+  {
+    Scan scan;
+    if (!scanLines(fqFile, scan))
+      continue;
+    addFile(FileSystem::Path::getRelativeFromPathToFile(path_, fqFile), scan);
+  }
+
+  // every file must be known before includes can be resolved
+  for (auto& item : scans_)
+    linkFile(depTable_, item.first);
+
+  std::cout << "\n    scanning completed!\n";
+}
+
+//----< relink one added or changed file, from its new scan >-------
+/*
+* Besides the file's own dependencies, relinks every file that
+* includes a file of the same name or uses a namespace the file
+* declares, before or after the change.
+*/
+void IncludeAnal::updateFile(DepTable& depTable, const File& fqFile, const Scan& scan)
+{
+  File file = FileSystem::Path::getRelativeFromPathToFile(path_, fqFile);
+  Names namespaces = scan.namespaces;
+  auto iter = scans_.find(file);
+  if (iter != scans_.end())
+    namespaces.insert(namespaces.end(), iter->second.namespaces.begin(), iter->second.namespaces.end());
+
+  dropFile(file);
+  addFile(file, scan);
+  linkFile(depTable, file);
+
+  for (auto& item : scans_)
+  {
+    if (item.first != file && refersTo(item.second, file, namespaces))
+      linkFile(depTable, item.first);
+  }
+}
+
+//----< forget a deleted file >--------------------------------------
+
+void IncludeAnal::removeFile(DepTable& depTable, const File& file)
+{
+  Names namespaces;
+  auto iter = scans_.find(file);
+  if (iter != scans_.end())
+    namespaces = iter->second.namespaces;
+
+  dropFile(file);
+  depTable.removeFile(file);
+
+  // a file name may have become unique
+  for (auto& item : scans_)
+  {
+    if (refersTo(item.second, file, namespaces))
+      linkFile(depTable, item.first);
+  }
+}
+
+//----< Test Stub >--------------------------------------------------
+
+#ifdef TEST_INCLUDEANAL
+
+#include "../Display/Display.h"
+
+int main()
+{
+  std::string path = FileSystem::Path::getFullFileSpec("..");
+  IncludeAnal::FileMap fileMap;
+  std::vector<std::string> dirs = { "../Analyzer", "../Parser", "../TestFiles" };
+  for (auto dir : dirs)
+  {
+    for (auto pattern : { "*.h", "*.cpp" })
+    {
+      for (auto file : FileSystem::Directory::getFiles(dir, pattern))
+        fileMap[pattern].push_back(FileSystem::Path::getFullFileSpec(dir + "/" + file));
+    }
+  }
+
+  IncludeAnal incAnal(fileMap, path);
+  incAnal.doIncludeAnal();
+  Display::showDepTable(incAnal.depTable(), std::cout);
+  std::cout << "\n\n";
+}
+
+#endif
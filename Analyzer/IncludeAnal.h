@@ -0,0 +1,109 @@
+#pragma once
+/////////////////////////////////////////////////////////////////////
+//  IncludeAnal.h - fast include-graph dependency analysis         //
+//  ver 1.1                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to perform code dependency analysis        //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+/*
+Package Operations:
+==================
+This package defines an IncludeAnal class, a cheaper alternative to
+TypeAnal and DepAnal. It needs no parser: a line scanner reads each
+file once and picks out
+- #include "..." lines, resolved first relative to the including
+  file, then by file name if exactly one repository file has it
+- using namespace directives, linked to every repository file that
+  declares that namespace
+The result is an approximation of the type based dependencies, put
+in the same DepTable the publisher and server consume.
+System includes, #include <...>, are ignored.
+
+Public Interface:
+=================
+IncludeAnal incAnal(fileMap, path);   // create an instance with filemap
+incAnal.doIncludeAnal();              // scan files and fill DepTable
+DepTable& table = incAnal.depTable(); // get dependencies
+IncludeAnal::Scan scan;
+IncludeAnal::scanLines(fqFile, scan); // read one added or changed file
+incAnal.updateFile(table, fqFile, scan); // relink it, reads no files
+incAnal.removeFile(table, file);      // drop file and its edges
+
+Build Process:
+==============
+Required files
+- IncludeAnal.h, IncludeAnal.cpp
+- DepAnal.h, DepAnal.cpp
+- FileSystem.h, FileSystem.cpp
+
+Maintenance History:
+====================
+ver 1.1 : 19 Oct 2026
+- updateFile takes the scan of the file, so the caller reads it
+  without holding a lock
+ver 1.0 : 19 Oct 2026
+- first release
+
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include "DepAnal.h"
+
+namespace CodeAnalysis
+{
+  ///////////////////////////////////////////////////////////////////
+  // IncludeAnal class finds dependencies from include lines and
+  // using directives
+  // - files are stored by path relative to the analysis path,
+  //   the same way DepTable stores them
+
+  class IncludeAnal
+  {
+  public:
+    using Pattern = std::string;
+    using Path = std::string;
+    using File = std::string;
+    using Files = std::vector<File>;
+    using FileMap = std::unordered_map<Pattern, Files>;
+    using Names = std::vector<std::string>;
+
+    struct Scan
+    {
+      Files includes;     // names inside #include "..."
+      Names usings;       // namespaces named by using directives
+      Names namespaces;   // namespaces the file declares
+    };
+
+    IncludeAnal() {}
+    IncludeAnal(FileMap& fileMap, Path analysisPath);
+    void doIncludeAnal();
+    void updateFile(DepTable& depTable, const File& fqFile, const Scan& scan);
+    void removeFile(DepTable& depTable, const File& file);
+    DepTable& depTable() { return depTable_; }
+
+    static bool scanLines(const File& fqFile, Scan& scan);
+
+  private:
+    void addFile(const File& file, const Scan& scan);
+    void dropFile(const File& file);
+    void linkFile(DepTable& depTable, const File& file);
+    bool refersTo(const Scan& scan, const File& file, const Names& namespaces);
+    File resolve(const File& file, const File& include);
+    static std::string key(const std::string& name);
+
+    Path path_;
+    Files sources_;                                 // fully qualified files to scan
+    DepTable depTable_;
+    std::unordered_map<File, Scan> scans_;          // file -> scan result
+    std::unordered_map<File, File> files_;          // lower case full path -> file
+    std::unordered_map<std::string, Files> names_;  // lower case file name -> files
+    std::unordered_map<std::string, std::unordered_set<File>> declared_;  // namespace -> files
+  };
+}
@@ -0,0 +1,260 @@
+/////////////////////////////////////////////////////////////////////
+//  TokenCache.cpp - sources and token spans kept from analysis    //
+//  ver 1.0                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to perform code dependency analysis        //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+
+#include "TokenCache.h"
+#include <iostream>
+#include <fstream>
+#include <cctype>
+
+using namespace CodeAnalysis;
+
+//----< can character be part of an identifier? >-------------------
+
+static bool isIdentChar(char c)
+{
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+//----< add span from start up to end >------------------------------
+
+static void addSpan(TokenCache::Spans& spans, size_t start, size_t end, TokenCache::Kind kind)
+{
+  TokenCache::Span span;
+  span.offset = start;
+  span.length = end - start;
+  span.kind = kind;
+  spans.push_back(span);
+}
+
+//----< skip quoted string or character, returns end offset >-------
+/*
+* An unterminated literal ends at the end of its line.
+*/
+static size_t skipQuoted(const std::string& source, size_t pos)
+{
+  char quote = source[pos++];
+  while (pos < source.size())
+  {
+    char c = source[pos];
+    if (c == '\\')
+      pos += 2;
+    else if (c == quote)
+      return pos + 1;
+    else if (c == '\n')
+      return pos;
+    else
+      ++pos;
+  }
+  return source.size();
+}
+
+//----< skip raw string R"delim(...)delim", pos is at the quote >---
+
+static size_t skipRaw(const std::string& source, size_t pos)
+{
+  size_t paren = source.find('(', pos + 1);
+  if (paren == std::string::npos)
+    return source.size();
+  std::string terminator = ")" + source.substr(pos + 1, paren - pos - 1) + "\"";
+  size_t end = source.find(terminator, paren + 1);
+  if (end == std::string::npos)
+    return source.size();
+  return end + terminator.size();
+}
+
+//----< is word a C++ keyword? >-------------------------------------
+
+bool TokenCache::isKeyword(const std::string& word)
+{
+  static const std::unordered_set<std::string> keywords = {
+    "alignas", "alignof", "asm", "auto", "bool", "break", "case", "catch",
+    "char", "char16_t", "char32_t", "class", "const", "constexpr",
+    "const_cast", "continue", "decltype", "default", "delete", "do",
+    "double", "dynamic_cast", "else", "enum", "explicit", "export",
+    "extern", "false", "final", "float", "for", "friend", "goto", "if",
+    "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+    "nullptr", "operator", "override", "private", "protected", "public",
+    "register", "reinterpret_cast", "return", "short", "signed", "sizeof",
+    "static", "static_assert", "static_cast", "struct", "switch",
+    "template", "this", "thread_local", "throw", "true", "try", "typedef",
+    "typeid", "typename", "union", "unsigned", "using", "virtual", "void",
+    "volatile", "wchar_t", "while"
+  };
+  return keywords.find(word) != keywords.end();
+}
+
+//----< find spans and identifiers of a source in one pass >---------
+/*
+* Identifiers include keywords, but nothing inside comments or
+* literals, so commented out code doesn't create dependencies.
+*/
+void TokenCache::lex(const std::string& source, Spans& spans, Identifiers& identifiers)
+{
+  spans.clear();
+  size_t size = source.size();
+  size_t pos = 0;
+  bool lineStart = true;  // only white space since the last newline
+  while (pos < size)
+  {
+    char c = source[pos];
+    char next = (pos + 1 < size) ? source[pos + 1] : '\0';
+    if (c == '\n')
+    {
+      lineStart = true;
+      ++pos;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+    {
+      ++pos;
+      continue;
+    }
+
+    size_t start = pos;
+    bool atLineStart = lineStart;
+    lineStart = false;
+    if (c == '/' && next == '/')
+    {
+      while (pos < size && source[pos] != '\n')
+        ++pos;
+      addSpan(spans, start, pos, comment);
+    }
+    else if (c == '/' && next == '*')
+    {
+      size_t end = source.find("*/", pos + 2);
+      pos = (end == std::string::npos) ? size : end + 2;
+      addSpan(spans, start, pos, comment);
+    }
+    else if (c == '"' || c == '\'')
+    {
+      pos = skipQuoted(source, pos);
+      addSpan(spans, start, pos, literal);
+    }
+    else if (c == '#' && atLineStart)
+    {
+      ++pos;
+      while (pos < size && (source[pos] == ' ' || source[pos] == '\t'))
+        ++pos;
+      while (pos < size && isIdentChar(source[pos]))
+        ++pos;
+      addSpan(spans, start, pos, directive);
+    }
+    else if (std::isdigit(static_cast<unsigned char>(c)) ||
+      (c == '.' && std::isdigit(static_cast<unsigned char>(next))))
+    {
+      // numbers, with suffixes, exponents and digit separators
+      ++pos;
+      while (pos < size && (isIdentChar(source[pos]) || source[pos] == '.' || source[pos] == '\''))
+      {
+        char e = source[pos++];
+        if ((e == 'e' || e == 'E' || e == 'p' || e == 'P') && pos < size &&
+          (source[pos] == '+' || source[pos] == '-'))
+          ++pos;
+      }
+    }
+    else if (isIdentChar(c))
+    {
+      while (pos < size && isIdentChar(source[pos]))
+        ++pos;
+      std::string word = source.substr(start, pos - start);
+      char quote = (pos < size) ? source[pos] : '\0';
+      if (quote == '"' && (word == "R" || word == "u8R" || word == "LR" || word == "uR" || word == "UR"))
+      {
+        pos = skipRaw(source, pos);
+        addSpan(spans, start, pos, literal);
+      }
+      else if ((quote == '"' || quote == '\'') && (word == "L" || word == "u" || word == "U" || word == "u8"))
+      {
+        pos = skipQuoted(source, pos);
+        addSpan(spans, start, pos, literal);
+      }
+      else
+      {
+        if (isKeyword(word))
+          addSpan(spans, start, pos, keyword);
+        identifiers.insert(word);
+      }
+    }
+    else
+      ++pos;
+  }
+}
+
+//----< read a whole file and lex it >-------------------------------
+
+bool TokenCache::scan(const File& fqFile, Entry& entry, Identifiers& identifiers)
+{
+  std::ifstream in(fqFile, std::ios::binary);
+  if (!in.good())
+  {
+    std::cout << "\n  can't open " << fqFile << "\n\n";
+    return false;
+  }
+  in.seekg(0, std::ios::end);
+  entry.source.resize(static_cast<size_t>(in.tellg()));
+  in.seekg(0, std::ios::beg);
+  if (entry.source.size() > 0)
+    in.read(&entry.source[0], entry.source.size());
+  entry.source.resize(static_cast<size_t>(in.gcount()));
+  in.close();
+
+  lex(entry.source, entry.spans, identifiers);
+  return true;
+}
+
+//----< cached source and spans of file, null if not cached >-------
+
+const TokenCache::Entry* TokenCache::find(const File& file) const
+{
+  auto iter = entries_.find(file);
+  if (iter == entries_.end())
+    return nullptr;
+  return &iter->second;
+}
+
+//----< memory held by cached sources and spans >--------------------
+
+size_t TokenCache::bytes() const
+{
+  size_t total = 0;
+  for (auto& item : entries_)
+    total += item.second.source.size() + item.second.spans.size() * sizeof(Span);
+  return total;
+}
+
+//----< Test Stub >--------------------------------------------------
+
+#ifdef TEST_TOKENCACHE
+
+int main()
+{
+  std::string source =
+    "#include \"TokenCache.h\"\n"
+    "// a comment\n"
+    "class Widget { int size = 0x1F; const char* name = R\"(raw \"text\")\"; };\n"
+    "/* block\n   comment */ char c = '\\'';\n";
+
+  TokenCache::Spans spans;
+  TokenCache::Identifiers identifiers;
+  TokenCache::lex(source, spans, identifiers);
+
+  const char* kinds[] = { "keyword", "comment", "literal", "directive" };
+  for (auto& span : spans)
+  {
+    std::cout << "\n  " << kinds[span.kind] << ": "
+      << source.substr(span.offset, span.length);
+  }
+  std::cout << "\n\n  identifiers:";
+  for (auto& identifier : identifiers)
+    std::cout << " " << identifier;
+  std::cout << "\n\n";
+}
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+/////////////////////////////////////////////////////////////////////
+//  TokenCache.h - sources and token spans kept from analysis      //
+//  ver 1.0                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to perform code dependency analysis        //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+/*
+Package Operations:
+==================
+This package defines a TokenCache class holding, for each analyzed
+file, its source text and the spans of its keywords, comments,
+string and character literals and preprocessor directives, as byte
+offsets into the source.
+A single lexer pass over a file produces both the spans and the set
+of identifiers dependency analysis matches type names against, so
+a file is read once per publish. The publisher then emits pages,
+with syntax highlighting, from the cached source and spans instead
+of reading the file again.
+Spans are sorted by offset and never overlap; bytes outside every
+span are plain code.
+
+Public Interface:
+=================
+TokenCache cache;                            // create an empty cache
+TokenCache::Entry entry;
+TokenCache::Identifiers ids;
+TokenCache::scan(fqFile, entry, ids);        // read and lex one file
+cache.add(file, std::move(entry));           // keep source and spans
+const TokenCache::Entry* e = cache.find(file);  // null if not cached
+cache.bytes();                               // memory held by sources and spans
+
+Build Process:
+==============
+Required files
+- TokenCache.h, TokenCache.cpp
+
+Maintenance History:
+====================
+ver 1.0 : 19 Oct 2026
+- first release
+
+*/
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+
+namespace CodeAnalysis
+{
+  ///////////////////////////////////////////////////////////////////
+  // TokenCache class keeps sources and token spans by file
+  // - files are stored by path relative to the analysis path,
+  //   the same way DepTable stores them
+
+  class TokenCache
+  {
+  public:
+    using File = std::string;
+    using Identifiers = std::unordered_set<std::string>;
+
+    enum Kind { keyword, comment, literal, directive };
+    struct Span
+    {
+      size_t offset;
+      size_t length;
+      Kind kind;
+    };
+    using Spans = std::vector<Span>;
+
+    struct Entry
+    {
+      std::string source;
+      Spans spans;
+    };
+
+    static bool scan(const File& fqFile, Entry& entry, Identifiers& identifiers);
+    static void lex(const std::string& source, Spans& spans, Identifiers& identifiers);
+    static bool isKeyword(const std::string& word);
+
+    void add(const File& file, Entry&& entry) { entries_[file] = std::move(entry); }
+    const Entry* find(const File& file) const;
+    void remove(const File& file) { entries_.erase(file); }
+    void clear() { entries_.clear(); }
+    size_t size() const { return entries_.size(); }
+    size_t bytes() const;
+
+  private:
+    std::unordered_map<File, Entry> entries_;
+  };
+}
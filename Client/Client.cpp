@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////
 //  Client.cpp - Remote Code Publisher Client                      //
-//  ver 1.0                                                        //
+//  ver 1.11                                                       //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform remote code publisher           //
@@ -10,11 +10,17 @@
 
 #include "Client.h"
 #include <iostream>
+#include <chrono>
+#include <cctype>
+#include <cstring>
 #include "../FileSystem/FileSystem.h"
 #include "../Utilities/Utilities.h"
 
+const size_t Client::PagePort;
+const size_t Client::FetchTimeout;
+
 //----< class constructor >----------------------------------------------
-Client::Client()
+Client::Client() : pageHandler_(this), pageListener_(PagePort, Socket::IP6)
 {
   tempDir_ = FileSystem::Directory::getCurrentDirectory() + "\\TempDir";
 
@@ -32,6 +38,8 @@ void Client::connectServer()
       Show::write("\n client waiting to connect");
       ::Sleep(100);
     }
+    if (!pagesServed_)
+      pagesServed_ = pageListener_.start(pageHandler_);
   }
   catch (std::exception& exc)
   {
@@ -58,6 +66,16 @@ void Client::parseAndSendMsg(const Message& msg)
     httpMsg.addAttribute(HttpMessage::Attribute("Path", args[1]));
     httpMsg.addAttribute(HttpMessage::Attribute("NoParent", args[2]));
   }
+  else if (cmdStr == "GetTree" && args.size() >= 2)
+  {
+    // GetTree,path[,depth[,offset[,limit]]], missing or 0 means all
+    httpMsg = makeMessage(1, "", "localhost::8080");
+    httpMsg.addAttribute(HttpMessage::Attribute("Command", cmdStr));
+    httpMsg.addAttribute(HttpMessage::Attribute("Path", args[1]));
+    const char* names[] = { "Depth", "Offset", "Limit" };
+    for (size_t i = 2; i < args.size() && i < 5; ++i)
+      httpMsg.addAttribute(HttpMessage::Attribute(names[i - 2], args[i]));
+  }
   else if (cmdStr == "Upload" && args.size() == 3)
   {
     std::string localPath = args[1];
@@ -71,10 +89,31 @@ void Client::parseAndSendMsg(const Message& msg)
     httpMsg.addAttribute(HttpMessage::Attribute("Command", cmdStr));
     httpMsg.addAttribute(HttpMessage::Attribute("Path", args[1]));
   }
+  else if (cmdStr == "GetDependents" && args.size() == 2)
+  {
+    httpMsg = makeMessage(1, "", "localhost::8080");
+    httpMsg.addAttribute(HttpMessage::Attribute("Command", cmdStr));
+    httpMsg.addAttribute(HttpMessage::Attribute("Path", args[1]));
+  }
+  else if (cmdStr == "GetChunk" && args.size() == 3)
+  {
+    httpMsg = makeMessage(1, "", "localhost::8080");
+    httpMsg.addAttribute(HttpMessage::Attribute("Command", cmdStr));
+    httpMsg.addAttribute(HttpMessage::Attribute("Path", args[1]));
+    httpMsg.addAttribute(HttpMessage::Attribute("Chunk", args[2]));
+  }
   else if (cmdStr == "Publish" || cmdStr == "DownloadCssJs")
   {
     httpMsg = makeMessage(1, "", "localhost::8080");
     httpMsg.addAttribute(HttpMessage::Attribute("Command", cmdStr));
+
+    // options such as Mode=Fast become attributes
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+      size_t pos = args[i].find('=');
+      if (pos != std::string::npos)
+        httpMsg.addAttribute(HttpMessage::Attribute(args[i].substr(0, pos), args[i].substr(pos + 1)));
+    }
   }
   else {
     return;
@@ -108,24 +147,53 @@ Client::Message Client::recvAndParseMsg()
   {
     returnMsg = "FileDirs," + httpMsg.bodyString();
   }
+  else if (content == "Tree")
+  {
+    // next page offset first, empty on the last page
+    returnMsg = "Tree," + httpMsg.findValue("Next") + "," + httpMsg.bodyString();
+  }
+  else if (content == "Dependents")
+  {
+    returnMsg = "Dependents," + httpMsg.bodyString();
+  }
   else if (content == "DelFile" || content == "DelDir")
   {
     returnMsg = content + "," + httpMsg.bodyString();
   }
   else if (content == "File")
   {
-    returnMsg = content + "," + httpMsg.findValue("path");
+    std::string path = httpMsg.findValue("path");
+    returnMsg = content + "," + path;
+    received(path, true);
     std::string openStr = httpMsg.findValue("open");
 
-    std::string downloadedFilePath = tempDir_ + "\\" + httpMsg.findValue("path");
+    std::string downloadedFilePath = tempDir_ + "\\" + path;
     if (openStr == "true" && FileSystem::Path::getExt(downloadedFilePath) == "htm")
     {
-      std::string command("start \"\" \"" + downloadedFilePath + "\"");
+      // through the page handler, so the page can load what it needs
+      std::string target = downloadedFilePath;
+      if (pagesServed_)
+        target = "http://localhost:" + Converter<size_t>::toString(PagePort) + "/" + urlOfPath(path);
+      std::string command("start \"\" \"" + target + "\"");
       std::system(command.c_str());
     }
   }
+  else if (content == "NoFile")
+  {
+    returnMsg = content + "," + httpMsg.findValue("path");
+    received(httpMsg.findValue("path"), false);
+  }
   else if (content == "Published")
+  {
+    // pages received before may have changed
+    std::lock_guard<std::mutex> lock(fetchMtx_);
+    fetched_.clear();
     returnMsg = content;
+  }
+  else if (content == "PublishQueued")
+    returnMsg = content + "," + httpMsg.findValue("JobId");
+  else if (content == "Progress" || content == "PublishFailed")
+    returnMsg = content + "," + httpMsg.bodyString();
   else
     returnMsg = "Invalid";
 
@@ -170,54 +238,234 @@ HttpMessage Client::makeMessage(size_t n, const std::string& body, const EndPoin
 }
 
 //----< send message using socket >----------------------------------
-
+/*
+* Header and body go out in one gathering send, without being
+* concatenated first.
+*/
 void Client::sendMessage(HttpMessage& msg, Socket& socket)
 {
-  std::string msgString = msg.toString();
-  socket.send(msgString.size(), (Socket::byte*)msgString.c_str());
+  std::lock_guard<std::mutex> lock(sendMtx_);
+  std::string header = msg.headerString();
+  HttpMessage::Body& body = msg.body();
+  Socket::Buffers buffers;
+  buffers.push_back({ header.data(), header.size() });
+  if (body.size() > 0)
+    buffers.push_back({ &body[0], body.size() });
+  socket.sendv(buffers);
 }
 
 //----< send file using socket >-------------------------------------
 /*
-* - Sends a message to tell receiver a file is coming.
-* - Then sends a stream of bytes until the entire file
-*   has been sent.
+* - Has the socket send a message to tell receiver a file is coming,
+*   then the file, with Socket::sendFile.
+* - Nothing is sent if the socket can't read the whole file.
 * - Sends in binary mode which works for either text or binary.
 */
 bool Client::sendFile(const std::string& localPath, const std::string& remotePath, Socket& socket)
 {
   // assumes that socket is connected
+  if (!FileSystem::File::exists(localPath))
+    return false;
   FileSystem::FileInfo fi(localPath);
   size_t fileSize = fi.size();
   std::string sizeString = Converter<size_t>::toString(fileSize);
-  FileSystem::File file(localPath);
-  file.open(FileSystem::File::in, FileSystem::File::binary);
-  if (!file.isGood())
-    return false;
 
   HttpMessage msg = makeMessage(1, "", "localhost::8080");
   msg.addAttribute(HttpMessage::Attribute("file", FileSystem::Path::getName(localPath)));
   msg.addAttribute(HttpMessage::Attribute("path", remotePath));
   msg.addAttribute(HttpMessage::Attribute("content-length", sizeString));
+  std::lock_guard<std::mutex> lock(sendMtx_);
+  if (!socket.sendFile(localPath, 0, fileSize, msg.headerString()))
+  {
+    Show::write("\n\n  can't send " + localPath);
+    return false;
+  }
   Show::write("\n\n  file sent\n" + msg.toIndentedString());
-  sendMessage(msg, socket);
-  const size_t BlockSize = 2048;
-  Socket::byte buffer[BlockSize];
+  return true;
+}
+
+//----< wait for a file from the server, unless it's here already >-
+/*
+* A file is here once received since the last publish, one left in
+* the temp dir by an earlier run may be out of date. The reply comes
+* to the thread calling recvAndParseMsg, which wakes the waiters.
+*/
+bool Client::fetch(const std::string& path)
+{
+  std::unique_lock<std::mutex> lock(fetchMtx_);
+  if (fetched_.count(path) > 0)
+    return true;
+  missing_.erase(path);
+  lock.unlock();
+
+  requestFile(path);
+
+  lock.lock();
+  fetchCv_.wait_for(lock, std::chrono::seconds(FetchTimeout),
+    [&]() { return fetched_.count(path) > 0 || missing_.count(path) > 0; });
+  missing_.erase(path);
+  return fetched_.count(path) > 0;
+}
+//----< ask the server for a file the browser wants >---------------
+/*
+* Chunks of a chunked page are asked for with GetChunk, as the page
+* scrolls them into view. Other files, pages reached by a link or a
+* search hit, index pages and search.js, are asked for with GetPage.
+*/
+void Client::requestFile(const std::string& path)
+{
+  HttpMessage msg = makeMessage(1, "", "localhost::8080");
+  size_t pos = path.rfind(".chunk");
+  std::string number;
+  if (pos != std::string::npos && FileSystem::Path::getExt(path) == "js")
+    number = path.substr(pos + 6, path.size() - pos - 6 - 3);
+  if (number.size() > 0 && number.find_first_not_of("0123456789") == std::string::npos)
+  {
+    msg.addAttribute(HttpMessage::Attribute("Command", "GetChunk"));
+    msg.addAttribute(HttpMessage::Attribute("Path", path.substr(0, pos)));
+    msg.addAttribute(HttpMessage::Attribute("Chunk", number));
+  }
+  else
+  {
+    msg.addAttribute(HttpMessage::Attribute("Command", "GetPage"));
+    msg.addAttribute(HttpMessage::Attribute("Path", path));
+  }
+  sendMessage(msg, si_);
+}
+//----< note a file received, or one the server hasn't got >---------
+
+void Client::received(const std::string& path, bool found)
+{
+  {
+    std::lock_guard<std::mutex> lock(fetchMtx_);
+    if (found)
+      fetched_.insert(path);
+    else
+      missing_.insert(path);
+  }
+  fetchCv_.notify_all();
+}
+//----< downloaded file named by a request target, e.g., /Dir/a.h.htm >
+/*
+* Returns an empty path for a target outside the temp dir.
+*/
+std::string Client::pathOfUrl(const std::string& url)
+{
+  size_t end = url.find_first_of("?#");
+  if (end == std::string::npos)
+    end = url.size();
+
+  std::string path;
+  for (size_t i = 0; i < end; ++i)
+  {
+    char ch = url[i];
+    if (ch == '%' && i + 2 < end && std::isxdigit((unsigned char)url[i + 1]) && std::isxdigit((unsigned char)url[i + 2]))
+    {
+      ch = static_cast<char>(std::stoi(url.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    }
+    path += (ch == '/' ? '\\' : ch);
+  }
+  path.erase(0, path.find_first_not_of('\\'));
+  if (path.find(':') != std::string::npos || ("\\" + path + "\\").find("\\..\\") != std::string::npos)
+    return "";
+  return path;
+}
+//----< request target of a downloaded file >-----------------------
+
+std::string Client::urlOfPath(const std::string& path)
+{
+  const char* hex = "0123456789ABCDEF";
+  std::string url;
+  for (char ch : path)
+  {
+    unsigned char uch = static_cast<unsigned char>(ch);
+    if (ch == '\\')
+      url += '/';
+    else if (std::isalnum(uch) || std::strchr("-._~", ch))
+      url += ch;
+    else
+    {
+      url += '%';
+      url += hex[uch >> 4];
+      url += hex[uch & 15];
+    }
+  }
+  return url;
+}
+//----< answer a GET with a downloaded file, fetching it first >-----
+/*
+* One request per connection, Connection: close has the browser open
+* another for its next file. Only requests from this machine are
+* answered.
+*/
+void PageHandler::operator()(Socket socket)
+{
+  std::string requestLine = socket.recvString('\n');
   while (true)
   {
-    FileSystem::Block blk = file.getBlock(BlockSize);
-    if (blk.size() == 0)
-      break;
-    for (size_t i = 0; i < blk.size(); ++i)
-      buffer[i] = blk[i];
-    socket.send(blk.size(), buffer);
-    if (!file.isGood())
+    // headers aren't used
+    std::string header = socket.recvString('\n');
+    if (header.size() <= 1)
       break;
   }
-  file.close();
-  return true;
+
+  std::string path;
+  size_t first = requestLine.find(' ');
+  size_t second = first == std::string::npos ? first : requestLine.find(' ', first + 1);
+  if (second != std::string::npos && requestLine.substr(0, first) == "GET")
+    path = Client::pathOfUrl(requestLine.substr(first + 1, second - first - 1));
+
+  std::string localPath = client_->tempDir_ + "\\" + path;
+  bool found = path.size() > 0 && fromLoopback(socket) && client_->fetch(path)
+    && FileSystem::File::exists(localPath);
+  if (found)
+  {
+    FileSystem::FileInfo fi(localPath);
+    size_t fileSize = fi.size();
+    std::string head = "HTTP/1.1 200 OK\r\nContent-Type: " + contentType(path)
+      + "\r\nContent-Length: " + Converter<size_t>::toString(fileSize)
+      + "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+    found = socket.sendFile(localPath, 0, fileSize, head);
+  }
+  if (!found)
+  {
+    std::string head = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    socket.sendv({ { head.data(), head.size() } });
+  }
+  socket.shutDown();
+  socket.close();
+}
+//----< content type of a page file >--------------------------------
+
+std::string PageHandler::contentType(const std::string& path)
+{
+  std::string ext = FileSystem::Path::getExt(path);
+  if (ext == "htm")
+    return "text/html";
+  if (ext == "js")
+    return "application/javascript";
+  if (ext == "css")
+    return "text/css";
+  return "application/octet-stream";
 }
+//----< is the socket's peer on this machine? >----------------------
 
+bool PageHandler::fromLoopback(Socket& socket)
+{
+  sockaddr_storage addr;
+  int size = sizeof(addr);
+  if (::getpeername(socket, reinterpret_cast<sockaddr*>(&addr), &size) != 0)
+    return false;
+  if (addr.ss_family == AF_INET)
+    return (::ntohl(reinterpret_cast<sockaddr_in*>(&addr)->sin_addr.s_addr) >> 24) == 127;
+  if (addr.ss_family == AF_INET6)
+  {
+    const IN6_ADDR& in6 = reinterpret_cast<sockaddr_in6*>(&addr)->sin6_addr;
+    return IN6_IS_ADDR_LOOPBACK(&in6) || (IN6_IS_ADDR_V4MAPPED(&in6) && in6.s6_addr[12] == 127);
+  }
+  return false;
+}
 //----< this defines processing to frame messages >------------------
 
 HttpMessage Client::readMessage(Socket& socket)
@@ -285,43 +533,12 @@ bool Client::readFile(const std::string& filename, size_t fileSize, Socket& sock
   std::string filePath = FileSystem::Path::getPath(localFileName);
   superCreateDir(filePath);
 
-  FileSystem::File file(localFileName);
-  file.open(FileSystem::File::out, FileSystem::File::binary);
-  if (!file.isGood())
-  {
-    /*
-    * This error handling is incomplete.  The client will continue
-    * to send bytes, but if the file can't be opened, then the server
-    * doesn't gracefully collect and dump them as it should.  That's
-    * an exercise left for students.
-    */
-    Show::write("\n\n  can't open file " + localFileName);
-    return false;
-  }
-
-  const size_t BlockSize = 2048;
-  Socket::byte buffer[BlockSize];
-
-  size_t bytesToRead;
-  while (true)
+  // bytes of a file that can't be written are still received, and dropped
+  if (!socket.recvFile(localFileName, fileSize))
   {
-    if (fileSize > BlockSize)
-      bytesToRead = BlockSize;
-    else
-      bytesToRead = fileSize;
-
-    socket.recv(bytesToRead, buffer);
-
-    FileSystem::Block blk;
-    for (size_t i = 0; i < bytesToRead; ++i)
-      blk.push_back(buffer[i]);
-
-    file.putBlock(blk);
-    if (fileSize < BlockSize)
-      break;
-    fileSize -= BlockSize;
+    Show::write("\n\n  can't save file " + localFileName);
+    return false;
   }
-  file.close();
   return true;
 }
 //----< progressively create directories >---------------------------
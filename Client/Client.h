@@ -1,7 +1,7 @@
 #pragma once
 /////////////////////////////////////////////////////////////////////
 //  Client.h - Remote Code Publisher Client                        //
-//  ver 1.0                                                        //
+//  ver 1.11                                                       //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform remote code publisher           //
@@ -14,6 +14,12 @@ Package Operations:
 This package defines a Client class to receive requests from GUI and
 send requests to the remote server. It as well as handle file tranfer.
 This class should be created and called by MockChannel.
+Opened pages are shown by the browser from a PageHandler, listening
+on localhost:8082, that serves the downloaded files. A file that
+hasn't been downloaded is asked for from the server when the browser
+wants it, so chunks of a chunked page come as they are scrolled into
+view, and pages reached from an index link or a search hit when they
+are followed.
 
 Public Interface:
 =================
@@ -32,11 +38,41 @@ Required files
 
 Maintenance History:
 ====================
+ver 1.11 : 19 Oct 2026
+- the PageHandler asks for pages, index pages and the search index
+  with GetPage, so links of any page it serves can be followed
+ver 1.10 : 19 Oct 2026
+- opened pages are served to the browser by a PageHandler, which
+  asks the server for chunks as the page loads them, instead of
+  fetching every chunk of a page one after another
+ver 1.9 : 19 Oct 2026
+- fetches chunks of a chunked page in the background, one GetChunk
+  after another, once the first chunk arrives
+ver 1.8 : 19 Oct 2026
+- added GetTree request, a subtree listing in one round trip
+ver 1.7 : 19 Oct 2026
+- passes PublishQueued, Progress and PublishFailed replies of a
+  background publish to the GUI
+ver 1.6 : 19 Oct 2026
+- messages go out with one gathering send of header and body
+ver 1.5 : 19 Oct 2026
+- downloads are received with Socket::recvFile
+ver 1.4 : 19 Oct 2026
+- uploads send file bytes with Socket::sendFile
+ver 1.3 : 19 Oct 2026
+- added GetChunk request for one chunk of a chunked page
+ver 1.2 : 19 Oct 2026
+- Publish forwards name=value options, e.g., Publish,Mode=Fast
+ver 1.1 : 19 Oct 2026
+- added GetDependents request and Dependents reply
 ver 1.0 : 06 May 2017
 - first release
 
 */
 #include <string>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
 #include "../HttpMessage/HttpMessage.h"
 #include "../Sockets/Sockets.h"
 #include "../Logger/Logger.h"
@@ -45,22 +81,55 @@ using Show = StaticLogger<1>;
 using namespace Utilities;
 using Utils = StringHelper;
 
+class Client;
+
+/////////////////////////////////////////////////////////////////////
+// PageHandler - answers one browser request for a downloaded file
+
+class PageHandler
+{
+public:
+  PageHandler(Client* client) : client_(client) {}
+  void operator()(Socket socket);
+private:
+  static std::string contentType(const std::string& path);
+  static bool fromLoopback(Socket& socket);
+  Client* client_;
+};
+
+/////////////////////////////////////////////////////////////////////
+// Client - GUI's connection to the server
+
 class Client
 {
 public:
   using Message = std::string;
   using EndPoint = std::string;
 
+  static const size_t PagePort = 8082;
+  static const size_t FetchTimeout = 10;  // seconds to wait for a file
+
   Client();
   void connectServer();
   void parseAndSendMsg(const Message& msg);
   Message recvAndParseMsg();
 
 private:
+  friend class PageHandler;
+
   SocketSystem ss_;
   SocketConnecter si_;
   bool connectionClosed_;
   std::string tempDir_;
+  std::mutex sendMtx_;  // GUI requests and page handler requests share the socket
+
+  PageHandler pageHandler_;
+  SocketListener pageListener_;
+  bool pagesServed_ = false;
+  std::mutex fetchMtx_;
+  std::condition_variable fetchCv_;
+  std::unordered_set<std::string> fetched_;  // files received since the last publish
+  std::unordered_set<std::string> missing_;  // files the server said it hasn't got
   
   HttpMessage makeMessage(size_t n, const std::string& msgBody, const EndPoint& ep);
   void sendMessage(HttpMessage& msg, Socket& socket);
@@ -70,4 +139,10 @@ private:
   bool readFile(const std::string& filename, size_t fileSize, Socket& socket);
 
   void superCreateDir(const std::string& path);
+
+  bool fetch(const std::string& path);
+  void requestFile(const std::string& path);
+  void received(const std::string& path, bool found);
+  static std::string pathOfUrl(const std::string& url);
+  static std::string urlOfPath(const std::string& path);
 };
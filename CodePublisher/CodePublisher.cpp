@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////
 //  CodePublisher.cpp - publish code to html files                 //
-//  ver 1.0                                                        //
+//  ver 2.2                                                        //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform code publisher                  //
@@ -10,19 +10,170 @@
 
 #include "CodePublisher.h"
 #include <vector>
+#include <map>
 #include <ctime>
 #include <stack>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
 #include "../FileSystem/FileSystem.h"
 
 using namespace CodePublisher;
 
+//----< html escapes of each byte, null for bytes copied as is >-----
+
+struct HtmlEscapes
+{
+  const char* text[256];
+
+  // in script strings backslashes and carriage returns are escaped too
+  HtmlEscapes(bool inScript = false)
+  {
+    for (auto& item : text)
+      item = nullptr;
+    text['&'] = "&amp;";
+    text['<'] = "&lt;";
+    text['>'] = "&gt;";
+    text['"'] = "&quot;";
+    if (inScript)
+    {
+      text['\\'] = "\\\\";
+      text['\r'] = "\\r";
+    }
+  }
+};
+
+static const HtmlEscapes htmlEscapes;
+static const HtmlEscapes scriptEscapes(true);
+
+//----< append text to html, escaping special characters >-----------
+
+static void appendEscaped(std::string& html, const char* begin, const char* end,
+  const HtmlEscapes& escapes = htmlEscapes)
+{
+  const char* run = begin;
+  for (const char* p = begin; p < end; ++p)
+  {
+    const char* escape = escapes.text[static_cast<unsigned char>(*p)];
+    if (escape)
+    {
+      html.append(run, p - run);
+      html.append(escape);
+      run = p + 1;
+    }
+  }
+  html.append(run, end - run);
+}
+
+//----< append decimal number, right aligned in width >--------------
+
+static void appendNumber(std::string& html, size_t number, size_t width = 0)
+{
+  char digits[24];
+  size_t pos = sizeof digits;
+  do
+  {
+    digits[--pos] = '0' + number % 10;
+    number /= 10;
+  } while (number > 0);
+
+  size_t len = sizeof digits - pos;
+  if (len < width)
+    html.append(width - len, ' ');
+  html.append(digits + pos, len);
+}
+
+//----< 64 bit FNV-1a hash, continuing from hash >------------------
+
+static unsigned long long fnv1a(const char* data, size_t len, unsigned long long hash = 14695981039346656037ULL)
+{
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+//----< appends source lines, wrapping token spans in html >---------
+/*
+* The markup of each line is complete: a span crossing a line end is
+* closed there and opened again on the next line, so lines can be
+* split into <pre> blocks, folded or chunked anywhere. Attribute
+* values aren't quoted, so lines can go into script strings as is.
+* Lines must be appended in order.
+*/
+class Highlighter
+{
+public:
+  Highlighter(const std::string& source, const TokenCache::Spans* spans) :
+    base_(source.data()), spans_(spans), cursor_(0) {}
+  void appendLine(std::string& html, const char* begin, const char* end,
+    const HtmlEscapes& escapes = htmlEscapes);
+
+private:
+  const char* base_;
+  const TokenCache::Spans* spans_;
+  size_t cursor_;  // first span not ending before the current line
+};
+
+void Highlighter::appendLine(std::string& html, const char* begin, const char* end, const HtmlEscapes& escapes)
+{
+  static const char* spanOpen[] = {
+    "<span class=kw>", "<span class=cm>", "<span class=st>", "<span class=pp>"
+  };
+  if (!spans_)
+  {
+    appendEscaped(html, begin, end, escapes);
+    return;
+  }
+
+  size_t lineBegin = begin - base_;
+  size_t lineEnd = end - base_;
+  const TokenCache::Spans& spans = *spans_;
+  while (cursor_ < spans.size() && spans[cursor_].offset + spans[cursor_].length <= lineBegin)
+    ++cursor_;
+
+  size_t pos = lineBegin;
+  for (size_t i = cursor_; i < spans.size() && spans[i].offset < lineEnd; ++i)
+  {
+    size_t start = spans[i].offset;
+    if (start < pos)
+      start = pos;
+    size_t stop = spans[i].offset + spans[i].length;
+    if (stop > lineEnd)
+      stop = lineEnd;
+    if (stop <= start)
+      continue;
+
+    appendEscaped(html, base_ + pos, base_ + start, escapes);
+    html += spanOpen[spans[i].kind];
+    appendEscaped(html, base_ + start, base_ + stop, escapes);
+    html += "</span>";
+    pos = stop;
+  }
+  appendEscaped(html, base_ + pos, end, escapes);
+}
+
+static const std::string ManifestHeader = "RemoteCodePublisher manifest\t";
+
 //----< Publisher constructor >--------------------------------------
 
 Publisher::Publisher(DepTable& depTable, Path analysisPath, Path publishPath) :
   _depTable(depTable), _analPath(analysisPath), _pubPath(publishPath),
-  ASTref_(Repository::getInstance()->AST())
+  _ownSink(new FileSink(publishPath)), _sink(_ownSink.get()), _tokens(nullptr), ASTref_(Repository::getInstance()->AST()), _workers(0), _foldMode(blockFolds),
+  _chunkLines(0), _pagesGenerated(0)
 {}
 
+//----< are all inputs of a page the same? >-------------------------
+
+bool Publisher::PageHashes::operator==(const PageHashes& other) const
+{
+  return source == other.source && deps == other.deps && scopes == other.scopes;
+}
+
 //----< DFS the AST to get all scope start and end line number >-----
 
 void Publisher::DFS4Scope(ASTNode* pNode)
@@ -34,6 +185,13 @@ void Publisher::DFS4Scope(ASTNode* pNode)
   {
     std::string type = pChild->type_;
 
+    // types are listed in the search index
+    if (type == "class" || type == "struct" || type == "interface" || type == "enum")
+    {
+      File file = FileSystem::Path::getRelativeFromPathToFile(_analPath, pChild->path_);
+      _typeNames[file].push_back(pChild->name_);
+    }
+
     if (type == "class" || type == "struct" || type == "function")
     {
       if (pChild->startLineCount_ == pChild->endLineCount_)
@@ -59,16 +217,35 @@ void Publisher::doPublish()
 
   // get Abstract Syntax Tree root
   ASTNode* pRoot = ASTref_.root();
+  _typeNames.clear();
   DFS4Scope(pRoot);
+  _scopeTable.freeze();
+
+  _options = "format=1";
+  _options += (_foldMode == compactFolds) ? ";folds=compact" : ";folds=blocks";
+  if (_chunkLines > 0)
+    _options += ";chunk=" + std::to_string(_chunkLines);
+  if (_tokens)
+    _options += ";highlight";
+  loadManifest();
 
   std::cout << "\n    generating css and javacript files.\n";
   genCssFile();
   genJsFile();
 
   std::cout << "\n    publishing codes to:" << _pubPath << "\n";
-  genCodePages();
-  genIndexPage();
-
+  Manifest manifest;
+  genCodePages(manifest);
+  removeStalePages(manifest);
+  genSearchFile(manifest);
+  if (indexChanged(manifest))
+    genIndexPages(manifest);
+  saveManifest(manifest);
+  if (!_sink->commit())
+    std::cout << "\n    can't commit published pages";
+  _manifest = manifest;
+
+  std::cout << "\n    " << _pagesGenerated << " of " << manifest.size() << " pages regenerated";
   std::cout << "\n    publishing completed!\n";
 }
 
@@ -76,20 +253,8 @@ void Publisher::doPublish()
 
 void Publisher::genCssFile()
 {
-  if (!FileSystem::Directory::exists(_pubPath))
-    FileSystem::Directory::create(_pubPath);
-
-  File cssFile = FileSystem::Path::getAbsoluteFileSpec(".\\template.css", _pubPath);
-
-  // open output file
-  std::ofstream out(cssFile);
-  if (!out.good())
-  {
-    std::cout << "\n  can't open " << cssFile << "\n\n";
-    return;
-  }
-
   // write content
+  std::ostringstream out;
   out << "body {\n";
   out << "  margin: 20px; color: black; background-color: #eee;\n";
   out << "  font-family: Consolas; font-weight: 600; font-size: 110%;\n";
@@ -106,29 +271,29 @@ void Publisher::genCssFile()
   out << "pre {\n";
   out << "  padding: 0; border: 0; margin: 0;\n";
   out << "}\n";
+  out << "\n";
+  out << ".fold {\n";
+  out << "  cursor: pointer;\n";
+  out << "}\n";
+  out << "\n";
+  out << "#chunks pre {\n";
+  out << "  line-height: 1.2em;\n";
+  out << "}\n";
+  out << "\n";
+  out << ".kw { color: blue; }\n";
+  out << ".cm { color: green; }\n";
+  out << ".st { color: #a31515; }\n";
+  out << ".pp { color: gray; }\n";
 
-  // close file
-  out.close();
+  writeIfChanged(".\\template.css", out.str());
 }
 
 //----< generate JavaScript file to the output dir >-----------------
 
 void Publisher::genJsFile()
 {
-  if (!FileSystem::Directory::exists(_pubPath))
-    FileSystem::Directory::create(_pubPath);
-
-  File jsFile = FileSystem::Path::getAbsoluteFileSpec(".\\template.js", _pubPath);
-
-  // open output file
-  std::ofstream out(jsFile);
-  if (!out.good())
-  {
-    std::cout << "\n  can't open " << jsFile << "\n\n";
-    return;
-  }
-
   // write content
+  std::ostringstream out;
   out << "function btn(id) {\n";
   out << "    if (id > 0) {\n";
   out << "        var unfold = document.getElementById(id);\n";
@@ -146,260 +311,927 @@ void Publisher::genJsFile()
   out << "        fold.style.display = 'none';\n";
   out << "    }\n";
   out << "}\n";
+  out << "\n";
+  out << "// compact pages keep their code in one <pre id=\"code\"> and call\n";
+  out << "// initFolds with [start, end] line pairs of the foldable scopes\n";
+  out << "var codeLines = [];\n";
+  out << "var codeFolds = [];\n";
+  out << "var folded = [];\n";
+  out << "\n";
+  out << "function initFolds(folds) {\n";
+  out << "    var code = document.getElementById('code');\n";
+  out << "    codeLines = code.innerHTML.split('\\n');\n";
+  out << "    if (codeLines.length > 0 && codeLines[codeLines.length - 1] === '')\n";
+  out << "        codeLines.pop();\n";
+  out << "    codeFolds = folds;\n";
+  out << "    folded = [];\n";
+  out << "    for (var k = 0; k < folds.length; k++)\n";
+  out << "        folded.push(false);\n";
+  out << "\n";
+  out << "    code.onclick = function (e) {\n";
+  out << "        var target = e.target || e.srcElement;\n";
+  out << "        var fold = target.getAttribute('data-fold');\n";
+  out << "        if (fold !== null) {\n";
+  out << "            folded[fold] = !folded[fold];\n";
+  out << "            renderCode();\n";
+  out << "        }\n";
+  out << "    };\n";
+  out << "    renderCode();\n";
+  out << "}\n";
+  out << "\n";
+  out << "function lineNumber(n) {\n";
+  out << "    var text = '' + n;\n";
+  out << "    while (text.length < 3)\n";
+  out << "        text = ' ' + text;\n";
+  out << "    return text;\n";
+  out << "}\n";
+  out << "\n";
+  out << "function renderCode() {\n";
+  out << "    var starts = {};\n";
+  out << "    var ends = {};\n";
+  out << "    for (var k = 0; k < codeFolds.length; k++) {\n";
+  out << "        starts[codeFolds[k][0]] = k;\n";
+  out << "        ends[codeFolds[k][1]] = true;\n";
+  out << "    }\n";
+  out << "\n";
+  out << "    var html = [];\n";
+  out << "    var depth = 0;\n";
+  out << "    for (var n = 1; n <= codeLines.length; n++) {\n";
+  out << "        var text = codeLines[n - 1];\n";
+  out << "        if (n in starts) {\n";
+  out << "            var fold = starts[n];\n";
+  out << "            var button = ' <span class=\"fold\" data-fold=\"' + fold + '\">';\n";
+  out << "            if (folded[fold]) {\n";
+  out << "                html.push(lineNumber(n) + button + '[+]</span>  ' + text + ' ...');\n";
+  out << "                n = codeFolds[fold][1];\n";
+  out << "                continue;\n";
+  out << "            }\n";
+  out << "            html.push(lineNumber(n) + button + '[-]</span>  ' + text);\n";
+  out << "            depth++;\n";
+  out << "        }\n";
+  out << "        else if (ends[n] && depth > 0) {\n";
+  out << "            html.push(lineNumber(n) + '  -   ' + text);\n";
+  out << "            depth--;\n";
+  out << "        }\n";
+  out << "        else\n";
+  out << "            html.push(lineNumber(n) + (depth > 0 ? '  |   ' : '      ') + text);\n";
+  out << "    }\n";
+  out << "    document.getElementById('code').innerHTML = html.join('\\n');\n";
+  out << "}\n";
+  out << "\n";
+  out << "// chunked pages get their code a chunk at a time, as chunk files are\n";
+  out << "// loaded with script tags, which also works for pages opened from disk\n";
+  out << "var chunkBase = '';\n";
+  out << "var chunkState = [];  // 0 not loaded, 1 loading, 2 loaded\n";
+  out << "var chunkTries = [];\n";
+  out << "\n";
+  out << "function initChunks(base, count, linesPerChunk, totalLines) {\n";
+  out << "    chunkBase = base;\n";
+  out << "    var div = document.getElementById('chunks');\n";
+  out << "    for (var n = 0; n < count; n++) {\n";
+  out << "        var pre = document.createElement('pre');\n";
+  out << "        pre.id = 'chunk' + n;\n";
+  out << "        var lines = Math.min(linesPerChunk, totalLines - n * linesPerChunk);\n";
+  out << "        pre.style.height = (lines * 1.2) + 'em';\n";
+  out << "        div.appendChild(pre);\n";
+  out << "        chunkState.push(0);\n";
+  out << "        chunkTries.push(0);\n";
+  out << "    }\n";
+  out << "    window.onscroll = loadVisibleChunks;\n";
+  out << "    window.onresize = loadVisibleChunks;\n";
+  out << "    loadVisibleChunks();\n";
+  out << "}\n";
+  out << "\n";
+  out << "function loadVisibleChunks() {\n";
+  out << "    var margin = window.innerHeight;\n";
+  out << "    for (var n = 0; n < chunkState.length; n++) {\n";
+  out << "        if (chunkState[n] !== 0)\n";
+  out << "            continue;\n";
+  out << "        var rect = document.getElementById('chunk' + n).getBoundingClientRect();\n";
+  out << "        if (rect.bottom > -margin && rect.top < window.innerHeight + margin)\n";
+  out << "            loadChunk(n);\n";
+  out << "    }\n";
+  out << "}\n";
+  out << "\n";
+  out << "function loadChunk(n) {\n";
+  out << "    chunkState[n] = 1;\n";
+  out << "    var head = document.getElementsByTagName('head')[0];\n";
+  out << "    var script = document.createElement('script');\n";
+  out << "    script.src = chunkBase + '.chunk' + n + '.js';\n";
+  out << "    script.onerror = function () {\n";
+  out << "        // chunk may still be on its way from the server, try again,\n";
+  out << "        // a few times, the server may not have it\n";
+  out << "        head.removeChild(script);\n";
+  out << "        if (++chunkTries[n] >= 3)\n";
+  out << "            return;\n";
+  out << "        chunkState[n] = 0;\n";
+  out << "        setTimeout(loadVisibleChunks, 500);\n";
+  out << "    };\n";
+  out << "    head.appendChild(script);\n";
+  out << "}\n";
+  out << "\n";
+  out << "function chunk(n, html) {\n";
+  out << "    var pre = document.getElementById('chunk' + n);\n";
+  out << "    pre.innerHTML = html;\n";
+  out << "    pre.style.height = '';\n";
+  out << "    chunkState[n] = 2;\n";
+  out << "}\n";
+  out << "\n";
+  out << "// index pages search the file and type names listed in search.js,\n";
+  out << "// searchNames holds [name, page] pairs, page indexes searchPages\n";
+  out << "var searchRoot = '';\n";
+  out << "\n";
+  out << "function initSearch(root) {\n";
+  out << "    searchRoot = root;\n";
+  out << "}\n";
+  out << "\n";
+  out << "function search(text) {\n";
+  out << "    var results = document.getElementById('results');\n";
+  out << "    text = text.toLowerCase();\n";
+  out << "    if (text.length === 0 || typeof searchNames === 'undefined') {\n";
+  out << "        results.innerHTML = '';\n";
+  out << "        return;\n";
+  out << "    }\n";
+  out << "    var html = [];\n";
+  out << "    for (var k = 0; k < searchNames.length && html.length < 100; k++) {\n";
+  out << "        var name = searchNames[k][0];\n";
+  out << "        if (name.toLowerCase().indexOf(text) < 0)\n";
+  out << "            continue;\n";
+  out << "        var page = searchPages[searchNames[k][1]];\n";
+  out << "        html.push('<a href=\"' + searchRoot + page.substring(2) + '.htm\">' + name + '</a>  ' + page);\n";
+  out << "    }\n";
+  out << "    results.innerHTML = html.join('<br>\\n');\n";
+  out << "}\n";
 
-  // close file
-  out.close();
+  writeIfChanged(".\\template.js", out.str());
 }
 
-//----< generate html pages for each file >--------------------------
-
-void Publisher::genCodePages()
+//----< generate html pages for each changed file >------------------
+/*
+* Pages are handed out in sorted order through a shared counter.
+* The scope table, page list and previous
+* manifest are only read while workers run; each worker stores the
+* hashes of its pages into its own slots.
+*/
+void Publisher::genCodePages(Manifest& manifest)
 {
+  std::vector<DepTable::Item> pages;
   for (auto item : _depTable)
+    pages.push_back(item);
+  std::sort(pages.begin(), pages.end(),
+    [](const DepTable::Item& a, const DepTable::Item& b) { return a.first < b.first; });
+
+  size_t numWorkers = _workers;
+  if (numWorkers == 0)
+    numWorkers = std::thread::hardware_concurrency();
+  if (numWorkers > pages.size())
+    numWorkers = pages.size();
+  if (numWorkers == 0)
+    numWorkers = 1;
+
+  std::vector<PageHashes> hashes(pages.size());
+  std::vector<char> published(pages.size(), 0);
+  std::atomic<size_t> generated(0);
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    PageBuffers buffers;
+    buffers.page.reserve(PageReserve);
+    size_t i;
+    while ((i = next++) < pages.size())
+    {
+      const File& file = pages[i].first;
+      try {
+        // sources the analysis kept aren't read again
+        const TokenCache::Entry* cached = _tokens ? _tokens->find(file) : nullptr;
+        const std::string& source = cached ? cached->source : buffers.source;
+        if (!cached && !readSource(file, buffers.source))
+          continue;
+        hashes[i] = pageHashes(file, pages[i].second, source);
+        published[i] = 1;
+
+        // skip pages whose inputs are unchanged
+        auto old = _manifest.find(file);
+        if (old != _manifest.end() && old->second == hashes[i] && _sink->exists(file + ".htm"))
+          continue;
+
+        if (genCodePage(file, pages[i].second, source, cached ? &cached->spans : nullptr, buffers))
+          ++generated;
+        else
+          published[i] = 0;
+      }
+      catch (std::exception& except)
+      {
+        published[i] = 0;
+        std::lock_guard<std::mutex> lock(_ioLock);
+        std::cout << "\n  can't publish " << file << ": " << except.what() << "\n\n";
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < numWorkers; ++i)
+    workers.push_back(std::thread(work));
+  work();  // calling thread is a worker too
+  for (auto& worker : workers)
+    worker.join();
+
+  for (size_t i = 0; i < pages.size(); ++i)
   {
-    std::string file = item.first;
-    std::string fullFileName = FileSystem::Path::getAbsoluteFileSpec(file, _analPath);
+    if (published[i])
+      manifest[pages[i].first] = hashes[i];
+  }
+  _pagesGenerated = generated;
+}
 
-    // open input file
-    std::ifstream in(fullFileName);
-    if (!in.good())
-    {
-      std::cout << "\n  can't open " << fullFileName << "\n\n";
+//----< read whole source file >-------------------------------------
+
+bool Publisher::readSource(const File& file, std::string& source)
+{
+  std::string fullFileName = FileSystem::Path::getAbsoluteFileSpec(file, _analPath);
+  std::ifstream in(fullFileName, std::ios::binary);
+  if (!in.good())
+  {
+    std::lock_guard<std::mutex> lock(_ioLock);
+    std::cout << "\n  can't open " << fullFileName << "\n\n";
+    return false;
+  }
+  in.seekg(0, std::ios::end);
+  source.resize(static_cast<size_t>(in.tellg()));
+  in.seekg(0, std::ios::beg);
+  if (source.size() > 0)
+    in.read(&source[0], source.size());
+  source.resize(static_cast<size_t>(in.gcount()));
+  return true;
+}
+
+//----< hash source, sorted dependencies and scope marks of a page >-
+
+Publisher::PageHashes Publisher::pageHashes(const File& file, const DepTable::Deps& deps, const std::string& source)
+{
+  PageHashes hashes;
+  hashes.source = fnv1a(source.data(), source.size());
+
+  std::vector<File> files(deps.begin(), deps.end());
+  std::sort(files.begin(), files.end());
+  hashes.deps = fnv1a(nullptr, 0);
+  for (auto& dep : files)
+    hashes.deps = fnv1a(dep.c_str(), dep.size() + 1, hashes.deps);  // with terminator
+
+  hashes.scopes = fnv1a(nullptr, 0);
+  for (auto& mark : _scopeTable.marks(file))
+  {
+    hashes.scopes = fnv1a(reinterpret_cast<const char*>(&mark.lineNo), sizeof mark.lineNo, hashes.scopes);
+    hashes.scopes = fnv1a(reinterpret_cast<const char*>(&mark.type), sizeof mark.type, hashes.scopes);
+  }
+  return hashes;
+}
+
+//----< generate html page for one file from its source >------------
+/*
+* Sources longer than the chunk size get a shell page, which loads
+* chunk files as they scroll into view. The page is built in the
+* worker's page buffer, after any chunk files, and handed to the sink
+* whole. With spans, tokens are highlighted.
+*/
+bool Publisher::genCodePage(const File& file, const DepTable::Deps& deps, const std::string& source,
+  const TokenCache::Spans* spans, PageBuffers& buffers)
+{
+  size_t numLines = countLines(source);
+  size_t numChunks = 0;
+  if (_chunkLines > 0 && numLines > _chunkLines)
+    numChunks = (numLines + _chunkLines - 1) / _chunkLines;
+
+  std::string& page = buffers.page;
+  bool ok = true;
+  if (numChunks > 0)
+    ok = genChunks(file, source, spans, page);
+
+  File webFileName = file + ".htm";
+  page.clear();
+  genPrologue(webFileName, page);
+  genHeader(file, page);
+  genDepList(file, deps, page);
+  if (numChunks > 0)
+  {
+    page += "<div id=\"chunks\"></div>\n";
+    page += "<script>initChunks(\"";
+    page += FileSystem::Path::getName(file);
+    page += "\", ";
+    appendNumber(page, numChunks);
+    page += ", ";
+    appendNumber(page, _chunkLines);
+    page += ", ";
+    appendNumber(page, numLines);
+    page += ");</script>\n";
+  }
+  else if (_foldMode == compactFolds)
+    genCompactCodeDiv(file, source, spans, page);
+  else
+    genCodeDiv(file, source, spans, page);
+  genFooter(page);
+
+  if (!_sink->write(webFileName, page))
+    return false;
+  removeChunks(file, numChunks);  // left over from a longer version
+  return ok;
+}
+
+//----< load manifest of previous publish, empty if options differ >-
+
+void Publisher::loadManifest()
+{
+  _manifest.clear();
+  std::string text;
+  if (!_sink->read(".\\publish.manifest", text))
+    return;
+  std::istringstream in(text);
+
+  std::string line;
+  if (!std::getline(in, line) || line != ManifestHeader + _options)
+    return;  // pages were made differently, redo all of them
+
+  while (std::getline(in, line))
+  {
+    // file, then source, deps and scopes hashes, separated by tabs
+    std::vector<std::string> fields;
+    std::istringstream fieldStream(line);
+    std::string field;
+    while (std::getline(fieldStream, field, '\t'))
+      fields.push_back(field);
+    if (fields.size() != 4)
       continue;
+
+    try {
+      PageHashes hashes;
+      hashes.source = std::stoull(fields[1], nullptr, 16);
+      hashes.deps = std::stoull(fields[2], nullptr, 16);
+      hashes.scopes = std::stoull(fields[3], nullptr, 16);
+      _manifest[fields[0]] = hashes;
     }
+    catch (std::exception&)
+    {
+      continue;  // damaged entry, page will be regenerated
+    }
+  }
+}
 
-    // create path if not exist
-    std::string webFileName = FileSystem::Path::getAbsoluteFileSpec(file, _pubPath) + ".htm";
-    std::string webFilePath = FileSystem::Path::getPath(webFileName);
-    if (!FileSystem::Directory::exists(webFilePath))
-      FileSystem::Directory::create(webFilePath);
+//----< save manifest of this publish, sorted by file >--------------
 
-    // open output file
-    std::ofstream out(webFileName);
-    if (!out.good())
-    {
-      std::cout << "\n  can't open " << webFileName << "\n\n";
+void Publisher::saveManifest(const Manifest& manifest)
+{
+  std::vector<File> files = manifestFiles(manifest);
+
+  std::ostringstream out;
+  out << ManifestHeader << _options << "\n" << std::hex;
+  for (auto& file : files)
+  {
+    const PageHashes& hashes = manifest.at(file);
+    out << file << "\t" << hashes.source << "\t" << hashes.deps << "\t" << hashes.scopes << "\n";
+  }
+
+  writeIfChanged(".\\publish.manifest", out.str());
+}
+
+//----< remove pages of files the previous publish had, but not this one >-
+
+void Publisher::removeStalePages(const Manifest& manifest)
+{
+  for (auto& item : _manifest)
+  {
+    if (manifest.find(item.first) != manifest.end())
       continue;
-    }
+    _sink->remove(item.first + ".htm");
+    removeChunks(item.first, 0);
+  }
+}
 
-    genPrologue(webFileName, out);
-    genHeader(file, out);
-    genDepList(file, item.second, out);
-    genCodeDiv(file, in, out);
-    genFooter(out);
+//----< has the set of published files changed? >-------------------
 
-    out.close();
-    in.close();
+bool Publisher::indexChanged(const Manifest& manifest)
+{
+  if (!_sink->exists(".\\index.htm") || manifest.size() != _manifest.size())
+    return true;
+  for (auto& item : manifest)
+  {
+    if (_manifest.find(item.first) == _manifest.end())
+      return true;
   }
+  return false;
 }
 
-//----< generate index html page to list all published files >-------
+//----< write file only if its content differs >---------------------
+/*
+* Leaves an unchanged file alone, so its timestamp stays the same
+* for clients that cache it.
+*/
+bool Publisher::writeIfChanged(const File& file, const std::string& content)
+{
+  std::string current;
+  if (_sink->read(file, current) && current == content)
+    return false;
+  return _sink->write(file, content);
+}
 
-void Publisher::genIndexPage()
+//----< directories of files, with all their parents >--------------
+/*
+* Directories end in a backslash, e.g., .\A\B\, and always include
+* the top-level directory .\
+*/
+Publisher::Dirs Publisher::indexDirs(const std::vector<File>& files)
 {
-  File indexFile = ".\\index.htm";
-  File indexFilePath = FileSystem::Path::getAbsoluteFileSpec(indexFile, _pubPath);
+  Dirs dirs;
+  dirs.insert(".\\");
+  for (auto& file : files)
+  {
+    Path dir = FileSystem::Path::getPath(file);
+    while (dirs.insert(dir).second)
+      dir = PathTable::parentDir(dir);
+  }
+  return dirs;
+}
 
-  // open output file
-  std::ofstream out(indexFilePath);
-  if (!out.good())
+//----< published files, sorted >-----------------------------------
+
+std::vector<Publisher::File> Publisher::manifestFiles(const Manifest& manifest)
+{
+  std::vector<File> files;
+  for (auto& item : manifest)
+    files.push_back(item.first);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+//----< generate an index page for each directory >------------------
+/*
+* Index pages of directories the previous publish had, but this one
+* doesn't, are removed.
+*/
+void Publisher::genIndexPages(const Manifest& manifest)
+{
+  std::vector<File> files = manifestFiles(manifest);
+  Dirs dirs = indexDirs(files);
+
+  // files directly in each directory, and counts of whole subtrees
+  std::map<Path, std::vector<File>> dirFiles;
+  std::unordered_map<Path, size_t> counts;
+  for (auto& file : files)
   {
-    std::cout << "\n  can't open " << indexFilePath << "\n\n";
-    return;
+    Path dir = FileSystem::Path::getPath(file);
+    dirFiles[dir].push_back(file);
+    for (;; dir = PathTable::parentDir(dir))
+    {
+      ++counts[dir];
+      if (dir == ".\\")
+        break;
+    }
   }
 
-  genPrologue(indexFile, out);  // prologue
-  genHeader(indexFile, out);  // html header
+  std::map<Path, Dirs> subDirs;
+  for (auto& dir : dirs)
+  {
+    if (dir != ".\\")
+      subDirs[PathTable::parentDir(dir)].insert(dir);
+  }
+
+  for (auto& dir : dirs)
+    genIndexPage(dir, subDirs[dir], dirFiles[dir], counts, dirs.size());
+
+  for (auto& dir : indexDirs(manifestFiles(_manifest)))
+  {
+    if (dirs.find(dir) == dirs.end())
+      _sink->remove(dir + "index.htm");
+  }
+
+  File indexFilePath = FileSystem::Path::getAbsoluteFileSpec(".\\index.htm", _pubPath);
+  std::cout << "\n    index web page: " << indexFilePath << "\n";
+}
+
+//----< generate index page of one directory >-----------------------
+
+void Publisher::genIndexPage(const Path& dir, const Dirs& subDirs, const std::vector<File>& files,
+  const std::unordered_map<Path, size_t>& counts, size_t numDirs)
+{
+  File indexFile = dir + "index.htm";
+  File searchFile = _paths.relative(indexFile, ".\\search.js");
+  std::string root = searchFile.substr(0, searchFile.size() - std::string("search.js").size());
+  auto count = counts.find(dir);
+  size_t numFiles = (count == counts.end()) ? 0 : count->second;
+
+  std::string html;
+  genPrologue(indexFile, html);  // prologue
+  genHeader(indexFile, html);  // html header
+  html += "  <script src=\"" + searchFile + "\"></script>\n";
+
+  // summary and search box
+  html += "  <hr />\n";
+  html += "  <div class=\"indent\">\n";
+  html += "    <h4>";
+  if (dir == ".\\")
+  {
+    appendNumber(html, numFiles);
+    html += " files in ";
+    appendNumber(html, numDirs);
+    html += " directories</h4>\n";
+  }
+  else
+  {
+    html += dir + " - ";
+    appendNumber(html, numFiles);
+    html += " files</h4>\n";
+  }
+  html += "    <input type=\"text\" placeholder=\"search files and types\" oninput=\"search(this.value)\">\n";
+  html += "    <div id=\"results\"></div>\n";
+  html += "  </div>\n";
+  html += "  <hr />\n";
 
-                              // gen html list
+  // gen html list, directories first
+  html += "  <div class=\"indent\">\n";
   bool isFirst = true;
-  for (auto item : _depTable)
+  if (dir != ".\\")
+  {
+    html += "    <a href=\"..\\index.htm\">..</a>\n";
+    isFirst = false;
+  }
+  for (auto& subDir : subDirs)
   {
-    std::string file = item.first;
+    if (isFirst)
+      isFirst = false;
+    else
+      html += "    <br>\n";  // to next line
 
+    std::string name = FileSystem::Path::getName(subDir.substr(0, subDir.size() - 1));
+    count = counts.find(subDir);
+    html += "    <a href=\"" + name + "\\index.htm\">" + name + "\\</a> (";
+    appendNumber(html, count == counts.end() ? 0 : count->second);
+    html += " files)\n";
+  }
+  for (auto& file : files)
+  {
     if (isFirst)
       isFirst = false;
     else
-      out << "    <br>" << "\n";  // to next line
+      html += "    <br>\n";  // to next line
 
-    File relPath = file + ".htm";
-    out << "    <a href=\"" << relPath << "\">" << file << "</a>" << "\n";
+    const std::string& name = _paths.name(file);
+    html += "    <a href=\"" + name + ".htm\">" + name + "</a>\n";
   }
+  html += "  </div>\n";
 
-  genFooter(out);  // html footer
+  html += "  <script>initSearch(\"";
+  appendEscaped(html, root.data(), root.data() + root.size(), scriptEscapes);
+  html += "\");</script>\n";
+  genFooter(html);  // html footer
 
-  out.close();  // close file
+  _sink->write(indexFile, html);
+}
 
-  std::cout << "\n    index web page: " << indexFilePath << "\n";
-  /*std::string command("start \"\" \"" + indexFilePath + "\"");
-  std::system(command.c_str());*/
+//----< generate search index of file and type names >--------------
+/*
+* Pages are listed once, in searchPages; each name refers to its page
+* by position. Names are sorted, so the file doesn't change unless
+* the names do.
+*/
+void Publisher::genSearchFile(const Manifest& manifest)
+{
+  std::vector<File> files = manifestFiles(manifest);
+  std::vector<std::pair<std::string, size_t>> names;
+
+  std::string js = "var searchPages = [";
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    if (i > 0)
+      js += ",";
+    js += "\n\"";
+    appendEscaped(js, files[i].data(), files[i].data() + files[i].size(), scriptEscapes);
+    js += "\"";
+
+    names.push_back(std::make_pair(_paths.name(files[i]), i));
+    auto types = _typeNames.find(files[i]);
+    if (types != _typeNames.end())
+    {
+      for (auto& type : types->second)
+        names.push_back(std::make_pair(type, i));
+    }
+  }
+  js += "];\n";
+
+  std::sort(names.begin(), names.end());
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+  js += "var searchNames = [";
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    if (i > 0)
+      js += ",";
+    js += "\n[\"";
+    appendEscaped(js, names[i].first.data(), names[i].first.data() + names[i].first.size(), scriptEscapes);
+    js += "\",";
+    appendNumber(js, names[i].second);
+    js += "]";
+  }
+  js += "];\n";
+
+  writeIfChanged(".\\search.js", js);
 }
 
 //----< generate prologue for each html file >-----------------------
 
-void Publisher::genPrologue(File file, std::ostream& out)
+void Publisher::genPrologue(File file, std::string& html)
 {
-  out << "<!----------------------------------------------------------------------------" << "\n";
-  out << "  " << FileSystem::Path::getName(file) << "\n";
+  html += "<!----------------------------------------------------------------------------\n";
+  html += "  " + FileSystem::Path::getName(file) + "\n";
 
   // get published time
   std::time_t curTime = std::time(nullptr);
   char timeStr[26];
   ctime_s(timeStr, sizeof timeStr, &curTime);
-  out << "  Published " << timeStr;
+  html += "  Published ";
+  html += timeStr;
 
-  out << "  Kaiqi Zhang, CSE687 - Object Oriented Design, Spring 2017" << "\n";
-  out << "----------------------------------------------------------------------------->" << "\n";
+  html += "  Kaiqi Zhang, CSE687 - Object Oriented Design, Spring 2017\n";
+  html += "----------------------------------------------------------------------------->\n";
 }
 
 //----< generate html header, link to css and js file >--------------
 
-void Publisher::genHeader(File file, std::ostream& out)
+void Publisher::genHeader(File file, std::string& html)
 {
-  std::string fileName = FileSystem::Path::getName(file);
+  const std::string& fileName = _paths.name(file);
 
-  File cssFile = FileSystem::Path::getRelativeFromFileToFile(file, ".\\template.css");
-  File JsFile = FileSystem::Path::getRelativeFromFileToFile(file, ".\\template.js");
+  File cssFile = _paths.relative(file, ".\\template.css");
+  File JsFile = _paths.relative(file, ".\\template.js");
 
-  out << "<html>" << "\n";
-  out << "<head>" << "\n";
+  html += "<html>\n";
+  html += "<head>\n";
 
   //out css link
-  out << "  <link rel=\"stylesheet\" type=\"text/css\" href=\"" << cssFile << "\">" << "\n";
+  html += "  <link rel=\"stylesheet\" type=\"text/css\" href=\"" + cssFile + "\">\n";
 
   //out js link
-  out << "  <script src=\"" << JsFile << "\"></script>" << "\n";
+  html += "  <script src=\"" + JsFile + "\"></script>\n";
 
-  out << "</head>" << "\n";
-  out << "<body>" << "\n";
-  out << "  <h3>" << fileName << "</h3>" << "\n";
+  html += "</head>\n";
+  html += "<body>\n";
+  html += "  <h3>" + fileName + "</h3>\n";
 }
 
 //----< generate html footer >---------------------------------------
 
-void Publisher::genFooter(std::ostream& out)
+void Publisher::genFooter(std::string& html)
 {
-  out << "</body>" << "\n";
-  out << "</html>" << "\n";
+  html += "</body>\n";
+  html += "</html>\n";
 }
 
 //----< generate dependency links >----------------------------------
 
-void Publisher::genDepList(File parent, DepTable::Deps deps, std::ostream& out)
+void Publisher::genDepList(File parent, DepTable::Deps deps, std::string& html)
 {
-  out << "  <hr />" << "\n";
-  out << "  <div class=\"indent\">" << "\n";
-  out << "    <h4>Dependencies:</h4>" << "\n";
+  html += "  <hr />\n";
+  html += "  <div class=\"indent\">\n";
+  html += "    <h4>Dependencies:</h4>\n";
 
-  // out files
+  // out files, sorted so pages don't change with hash order
+  std::vector<File> files(deps.begin(), deps.end());
+  std::sort(files.begin(), files.end());
   bool isFirst = true;
 
-  for (auto file : deps)
+  for (auto file : files)
   {
     if (isFirst)
       isFirst = false;
     else
-      out << "    <br>" << "\n";  // to next line
+      html += "    <br>\n";  // to next line
 
-    std::string filename = FileSystem::Path::getName(file);
-    File relPath = FileSystem::Path::getRelativeFromFileToFile(parent, file) + ".htm";
-    out << "    <a href=\"" << relPath << "\">" << filename << "</a>" << "\n";
+    const std::string& filename = _paths.name(file);
+    File relPath = _paths.relative(parent, file) + ".htm";
+    html += "    <a href=\"" + relPath + "\">" + filename + "</a>\n";
   }
 
-  out << "  </div>" << "\n";
-  out << "  <hr />" << "\n";
+  html += "  </div>\n";
+  html += "  <hr />\n";
 }
 
-//----< add line no. and javascipt prefix to every line of code >-----
-
-void Publisher::addCodeLinePrefix(File file, std::vector<std::string>& lines)
+//----< generate code div in html >----------------------------------
+/*
+* One pass over the source. Each line gets its number and fold
+* markup:
+* - a scope start line opens a new <pre> with a [-] button
+* - a scope end line closes it, followed by a hidden <pre> with a
+*   [+] button and the scope's first line, shown when folded
+* Lines are appended to html, the page being built.
+*/
+void Publisher::genCodeDiv(const File& file, const std::string& source, const TokenCache::Spans* spans,
+  std::string& html)
 {
-  int btnId = 1;
-  std::stack<int> scopeFirstLineNumber;
-  std::stack<std::string> scopeFirstLine;
-  std::stack<int> scopeBtnId;
-
-  for (size_t i = 0; i < lines.size(); i++)
+  Highlighter highlighter(source, spans);
+  struct Fold
   {
-    std::ostringstream temp;
-    temp << std::right;
+    size_t btnId;
+    size_t lineNo;
+    std::string firstLine;  // escaped
+  };
+  std::vector<Fold> folds;
+  size_t btnId = 1;
+  size_t lineNo = 0;
+
+  // marks are sorted by line, so one cursor follows the lines
+  const ScopeTable::Marks& marks = _scopeTable.marks(file);
+  size_t cursor = 0;
 
-    ScopeTable::ScopeType type = _scopeTable.lineType(file, i + 1);
+  // code div start
+  html += "<pre>\n";
 
+  const char* pos = source.data();
+  const char* end = pos + source.size();
+  while (pos < end)
+  {
+    const char* nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    const char* lineEnd = nl ? nl : end;
+    const char* next = nl ? nl + 1 : end;
+    if (lineEnd > pos && lineEnd[-1] == '\r')
+      --lineEnd;
+    ++lineNo;
+
+    while (cursor < marks.size() && marks[cursor].lineNo < lineNo)
+      ++cursor;
+    ScopeTable::ScopeType type = ScopeTable::none;
+    if (cursor < marks.size() && marks[cursor].lineNo == lineNo)
+      type = marks[cursor].type;
     if (type == ScopeTable::start)  // scope begin
     {
-      scopeFirstLine.push(lines[i]);
-      scopeFirstLineNumber.push(i + 1);
-      scopeBtnId.push(btnId);
-
-      temp << "</pre>" << "\n";
-      temp << "<pre id=\"" << btnId++ << "\" onclick=\"btn(this.id)\">" << "\n";
-      temp << std::setw(3) << i + 1 << " [-]  " << lines[i] << "\n";
+      html += "</pre>\n<pre id=\"";
+      appendNumber(html, btnId);
+      html += "\" onclick=\"btn(this.id)\">\n";
+      appendNumber(html, lineNo, 3);
+      html += " [-]  ";
+      size_t first = html.size();
+      highlighter.appendLine(html, pos, lineEnd);
+      folds.push_back(Fold{ btnId++, lineNo, html.substr(first) });
+      html += "\n";
     }
-    else if (type == ScopeTable::end)  // scope end
+    else if (type == ScopeTable::end && !folds.empty())  // scope end
     {
-      temp << std::setw(3) << i + 1 << "  -   " << lines[i] << "\n";
+      appendNumber(html, lineNo, 3);
+      html += "  -   ";
+      highlighter.appendLine(html, pos, lineEnd);
+      html += "\n";
 
       // insert collapsed lines
-      temp << "</pre>" << "\n";
-      temp << "<pre id=\"" << -scopeBtnId.top() << "\" style=\"display:none\" onclick=\"btn(this.id)\">" << "\n";
-      temp << std::setw(3) << scopeFirstLineNumber.top() << " [+]  " << scopeFirstLine.top().c_str() << " ..." << "\n";
-      temp << "</pre>" << "\n";
-      temp << "<pre>" << "\n";
-
-      scopeBtnId.pop();
-      scopeFirstLineNumber.pop();
-      scopeFirstLine.pop();
+      Fold& fold = folds.back();
+      html += "</pre>\n<pre id=\"-";
+      appendNumber(html, fold.btnId);
+      html += "\" style=\"display:none\" onclick=\"btn(this.id)\">\n";
+      appendNumber(html, fold.lineNo, 3);
+      html += " [+]  ";
+      html += fold.firstLine;
+      html += " ...\n</pre>\n<pre>\n";
+      folds.pop_back();
     }
-    else if (!scopeBtnId.empty())
-      temp << std::setw(3) << i + 1 << "  |   " << lines[i] << "\n";
     else
-      temp << std::setw(3) << i + 1 << "      " << lines[i] << "\n";
-
-    lines[i] = temp.str();
+    {
+      appendNumber(html, lineNo, 3);
+      html += folds.empty() ? "      " : "  |   ";
+      highlighter.appendLine(html, pos, lineEnd);
+      html += "\n";
+    }
+    pos = next;
   }
-}
 
-//----< generate code div in html >----------------------------------
+  // code div end
+  html += "</pre>\n";
+}
 
-void Publisher::genCodeDiv(File file, std::istream& in, std::ostream& out)
+//----< generate code div with fold ranges in html >----------------
+/*
+* The code is emitted once, escaped, without line numbers. Scope
+* marks are paired the same way genCodeDiv pairs them and written as
+* [start, end] line pairs for initFolds in template.js.
+*/
+void Publisher::genCompactCodeDiv(const File& file, const std::string& source, const TokenCache::Spans* spans,
+  std::string& html)
 {
-  // code div start
-  out << "<pre>" << "\n";
+  Highlighter highlighter(source, spans);
+  html += "<pre id=\"code\">\n";
 
-  // step 1: get original lines & replace < >
-  std::vector<std::string> lines;
-  std::string line;
-  while (std::getline(in, line))
+  const char* pos = source.data();
+  const char* end = pos + source.size();
+  while (pos < end)
   {
-    StringReplace(line, "<", "&lt");
-    StringReplace(line, ">", "&gt");
-    lines.push_back(line);
+    const char* nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    const char* lineEnd = nl ? nl : end;
+    const char* next = nl ? nl + 1 : end;
+    if (lineEnd > pos && lineEnd[-1] == '\r')
+      --lineEnd;
+    highlighter.appendLine(html, pos, lineEnd);
+    html += "\n";
+    pos = next;
   }
+  html += "</pre>\n";
 
-  // step 2: add prefix
-  addCodeLinePrefix(file, lines);
+  // pair starts with ends, folds are listed by start line
+  std::vector<std::pair<size_t, size_t>> folds;
+  std::vector<size_t> open;
+  for (auto& mark : _scopeTable.marks(file))
+  {
+    if (mark.type == ScopeTable::start)
+    {
+      open.push_back(folds.size());
+      folds.push_back(std::make_pair(mark.lineNo, mark.lineNo));
+    }
+    else if (mark.type == ScopeTable::end && !open.empty())
+    {
+      folds[open.back()].second = mark.lineNo;
+      open.pop_back();
+    }
+  }
+
+  html += "<script>initFolds([";
+  bool isFirst = true;
+  for (auto& fold : folds)
+  {
+    if (fold.first == fold.second)
+      continue;  // never closed
+    if (!isFirst)
+      html += ",";
+    isFirst = false;
+    html += "[";
+    appendNumber(html, fold.first);
+    html += ",";
+    appendNumber(html, fold.second);
+    html += "]";
+  }
+  html += "]);</script>\n";
+}
 
-  // step 3: dump all lines
-  for (std::string nline : lines)
-    out << nline.c_str();
+//----< name of a chunk file, relative like file >--------------------
 
-  // code div end
-  out << "</pre>" << "\n";
+Publisher::File Publisher::chunkFile(const File& file, size_t chunk)
+{
+  return file + ".chunk" + std::to_string(chunk) + ".js";
 }
 
-//----< replace a specified characters in a string >-----------------
+//----< number of lines in a source >--------------------------------
 
-void Publisher::StringReplace(std::string &strBase, std::string strSrc, std::string strDes)
+size_t Publisher::countLines(const std::string& source)
 {
-  std::string::size_type srcLen = strSrc.size();
-  std::string::size_type desLen = strDes.size();
-  std::string::size_type pos = strBase.find(strSrc, 0);
+  size_t count = std::count(source.begin(), source.end(), '\n');
+  if (source.size() > 0 && source.back() != '\n')
+    ++count;  // last line has no newline
+  return count;
+}
 
-  while ((pos != std::string::npos))
+//----< write chunk files of a long source >-------------------------
+/*
+* Each chunk file is a script calling chunk(n, "...") with the
+* numbered, escaped lines of one chunk. Chunked pages don't fold.
+*/
+bool Publisher::genChunks(const File& file, const std::string& source, const TokenCache::Spans* spans, std::string& html)
+{
+  Highlighter highlighter(source, spans);
+  const char* pos = source.data();
+  const char* end = pos + source.size();
+  size_t lineNo = 0;
+  size_t chunk = 0;
+  while (pos < end)
+  {
+    html.clear();
+    html += "chunk(";
+    appendNumber(html, chunk);
+    html += ", \"";
+    for (size_t i = 0; i < _chunkLines && pos < end; ++i)
+    {
+      const char* nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+      const char* lineEnd = nl ? nl : end;
+      const char* next = nl ? nl + 1 : end;
+      if (lineEnd > pos && lineEnd[-1] == '\r')
+        --lineEnd;
+
+      appendNumber(html, ++lineNo, 3);
+      html += "      ";
+      highlighter.appendLine(html, pos, lineEnd, scriptEscapes);
+      html += "\\n";
+      pos = next;
+    }
+    html += "\");\n";
+
+    if (!_sink->write(chunkFile(file, chunk), html))
+      return false;
+    ++chunk;
+  }
+  html.clear();
+  return true;
+}
+
+//----< remove chunk files of file, starting at chunk first >--------
+
+void Publisher::removeChunks(const File& file, size_t first)
+{
+  for (size_t chunk = first; ; ++chunk)
   {
-    strBase.replace(pos, srcLen, strDes);
-    pos = strBase.find(strSrc, (pos + desLen));
+    File chunkFileName = chunkFile(file, chunk);
+    if (!_sink->exists(chunkFileName))
+      break;
+    _sink->remove(chunkFileName);
   }
 }
 
@@ -1,7 +1,7 @@
 #pragma once
 /////////////////////////////////////////////////////////////////////
 //  CodePublisher.h - publish code to html files                   //
-//  ver 1.0                                                        //
+//  ver 2.2                                                        //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform code publisher                  //
@@ -15,31 +15,115 @@ This package defines a Publisher class to publish source code files
 as web pages.
 The web pages contains embeded child links. Each link refers to a 
 code file that the displayed file depends on.
+Code pages are independent of each other, so they are generated by a
+pool of worker threads. Each worker holds one page at a time, which
+bounds memory in flight, and a page's content depends only on its own
+source, dependencies and scopes, so output doesn't depend on timing.
+Code is emitted in a single pass over the source: characters are
+escaped through a lookup table and appended, with line numbers and
+fold markup, to a buffer each worker reuses from page to page.
+Publishing is incremental. A manifest in the publish directory keeps,
+for each page, hashes of its source, its dependency list and its
+scope marks, plus the page format and options in a header line. Only
+pages with a changed hash are regenerated, pages of files no longer
+published are removed, and the index is rewritten only when the set
+of files changed. CSS, JavaScript and manifest files are written only
+when their bytes differ, so unchanged files keep their timestamps.
+Scope folding has two modes. Block folds, the default, split the code
+into <pre> elements and add a hidden copy of each scope's first line.
+Compact folds emit the code once in a single <pre> plus an array of
+[start, end] line pairs; template.js adds line numbers and folds the
+code in the browser.
+With a chunk size set, a source longer than the chunk size gets a
+small shell page, plus one script file per chunk of lines, e.g.,
+File.cpp.chunk0.js. The shell loads chunks as they scroll into view,
+so the time to first paint doesn't grow with the length of the file.
+Each directory of published files gets its own index.htm, listing
+its subdirectories and files; the top-level index also sums up the
+whole repository. Index pages share a search box backed by
+search.js, a compact list of file and type names with the page each
+is in, so pages can be found without fetching the whole site.
+Given the TokenCache of the dependency analysis, pages are made from
+the cached sources, without reading the files again, and keywords,
+comments, literals and preprocessor directives are highlighted from
+the cached token spans in the same pass.
+Links are made through a PathTable, which interns files and
+directories and computes each relative path between two directories
+once.
+All output goes through a PageSink under names relative to the
+publish directory. By default that is a FileSink on the publish
+path; setSink swaps in, e.g., a MemorySink or an ArchiveSink.
 
 Public Interface:
 =================
 Publisher publisher;                  // create a code publisher instance
-publisher.doPublish();                // do publish codes
+publisher.setWorkers(4);              // threads generating pages, 0 for one per core
+publisher.setFoldMode(Publisher::compactFolds);  // fold in browser from fold ranges
+publisher.setChunkLines(2000);        // split sources over 2000 lines, 0 for never
+publisher.setSink(archive);           // write pages to another sink, e.g., a pack
+publisher.setTokenCache(&depAnal.tokenCache());  // cached sources, highlighted pages
+File chunk = Publisher::chunkFile(".\\File.cpp", 0);  // ".\\File.cpp.chunk0.js"
+publisher.doPublish();                // do publish codes, changed pages only
+publisher.pagesGenerated();           // number of pages the last publish wrote
+Dirs dirs = Publisher::indexDirs(files);  // directories with an index.htm
 
 Build Process:
 ==============
 Required files
 - CodePublisher.h, CodePublisher.cpp
 - ScopeTable.h, ScopeTable.cpp
+- PageSink.h, PageSink.cpp
+- PathTable.h, PathTable.cpp
 - DepAnal.h, DepAnal.cpp
+- TokenCache.h, TokenCache.cpp
 - AbstrSynTree.h, AbstrSynTree.cpp
 
 Maintenance History:
 ====================
+ver 2.2 : 19 Oct 2026
+- a worker builds each code page, and its chunk files, in one string
+  it reuses, which goes to the sink without being copied
+ver 2.1 : 19 Oct 2026
+- template.js tries a chunk that fails to load three times, not for
+  as long as the page is open
+ver 2.0 : 19 Oct 2026
+- links come from a PathTable with memoized relative paths
+ver 1.9 : 19 Oct 2026
+- pages can be made from a TokenCache, with syntax highlighting
+ver 1.8 : 19 Oct 2026
+- one index page per directory and a search index of file and type
+  names, instead of a single flat index page
+ver 1.7 : 19 Oct 2026
+- output goes through a pluggable PageSink
+ver 1.6 : 19 Oct 2026
+- added chunked pages for long sources
+ver 1.5 : 19 Oct 2026
+- added compact fold mode, code is emitted once with fold ranges
+ver 1.4 : 19 Oct 2026
+- incremental publishing driven by a publish manifest
+ver 1.3 : 19 Oct 2026
+- code emitter walks a file's sorted scope marks with a cursor
+ver 1.2 : 19 Oct 2026
+- single pass code emitter with reusable buffers, also escapes & and "
+ver 1.1 : 19 Oct 2026
+- generate code pages in parallel, dependency links are sorted
 ver 1.0 : 08 Apr 2017
 - first release
 
 */
 
 #include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
 #include "../Analyzer/DepAnal.h"
+#include "../Analyzer/TokenCache.h"
 #include "../AbstractSyntaxTree/AbstrSynTree.h"
 #include "ScopeTable.h"
+#include "PageSink.h"
+#include "PathTable.h"
 
 namespace CodePublisher
 {
@@ -53,31 +137,88 @@ namespace CodePublisher
   public:
     using Path = std::string;
     using File = std::string;
+    using Dirs = std::set<Path>;
+    enum FoldMode { blockFolds, compactFolds };
 
     Publisher(DepTable& depTable, Path analysisPath, Path publishPath);
     void doPublish();
+    void setWorkers(size_t workers) { _workers = workers; }
+    void setFoldMode(FoldMode foldMode) { _foldMode = foldMode; }
+    void setChunkLines(size_t chunkLines) { _chunkLines = chunkLines; }
+    void setSink(PageSink& sink) { _sink = &sink; }
+    void setTokenCache(const TokenCache* tokens) { _tokens = tokens; }
+    size_t pagesGenerated() { return _pagesGenerated; }
     DepTable& depTable() { return _depTable; }
+    static File chunkFile(const File& file, size_t chunk);
+    static Dirs indexDirs(const std::vector<File>& files);
 
   private:
+    // buffers a worker reuses for every page it generates
+    struct PageBuffers
+    {
+      std::string source;  // whole source file
+      std::string page;    // code page, or one chunk file, being built
+    };
+    static const size_t PageReserve = 256 * 1024;
+
+    // hashes of everything a code page is generated from
+    using Hash = unsigned long long;
+    struct PageHashes
+    {
+      Hash source;
+      Hash deps;
+      Hash scopes;
+      bool operator==(const PageHashes& other) const;
+    };
+    using Manifest = std::unordered_map<File, PageHashes>;
+
     AbstrSynTree& ASTref_;
     DepTable _depTable;
     Path _analPath;
     Path _pubPath;
+    std::unique_ptr<PageSink> _ownSink;  // FileSink on _pubPath
+    PageSink* _sink;                     // where pages are written
+    const TokenCache* _tokens;           // sources and spans of analysis, may be null
     ScopeTable _scopeTable;
+    PathTable _paths;  // names and relative paths of links
+    size_t _workers;
+    FoldMode _foldMode;
+    size_t _chunkLines;
+    size_t _pagesGenerated;
+    std::string _options;  // page format and options, pages are redone when changed
+    Manifest _manifest;    // of the previous publish
+    std::mutex _ioLock;  // serializes console output of workers
+    std::unordered_map<File, std::vector<std::string>> _typeNames;  // file -> types it defines
 
     void genCssFile();
     void genJsFile();
-    void genCodePages();
-    void genIndexPage();
-
-    void genPrologue(File file, std::ostream& out);
-    void genHeader(File file, std::ostream& out);
-    void genFooter(std::ostream& out);
-    void genDepList(File parent, DepTable::Deps deps, std::ostream& out);
-    void genCodeDiv(File file, std::istream& in, std::ostream& out);
+    void genCodePages(Manifest& manifest);
+    bool readSource(const File& file, std::string& source);
+    PageHashes pageHashes(const File& file, const DepTable::Deps& deps, const std::string& source);
+    void loadManifest();
+    void saveManifest(const Manifest& manifest);
+    void removeStalePages(const Manifest& manifest);
+    bool indexChanged(const Manifest& manifest);
+    bool writeIfChanged(const File& file, const std::string& content);
+    bool genCodePage(const File& file, const DepTable::Deps& deps, const std::string& source,
+      const TokenCache::Spans* spans, PageBuffers& buffers);
+    void genIndexPages(const Manifest& manifest);
+    void genIndexPage(const Path& dir, const Dirs& subDirs, const std::vector<File>& files,
+      const std::unordered_map<Path, size_t>& counts, size_t numDirs);
+    void genSearchFile(const Manifest& manifest);
+    static std::vector<File> manifestFiles(const Manifest& manifest);
 
-    void addCodeLinePrefix(File file, std::vector<std::string>& lines);
-    void StringReplace(std::string &strBase, std::string strSrc, std::string strDes);
+    void genPrologue(File file, std::string& html);
+    void genHeader(File file, std::string& html);
+    void genFooter(std::string& html);
+    void genDepList(File parent, DepTable::Deps deps, std::string& html);
+    void genCodeDiv(const File& file, const std::string& source, const TokenCache::Spans* spans,
+      std::string& html);
+    void genCompactCodeDiv(const File& file, const std::string& source, const TokenCache::Spans* spans,
+      std::string& html);
+    bool genChunks(const File& file, const std::string& source, const TokenCache::Spans* spans, std::string& html);
+    void removeChunks(const File& file, size_t first);
+    static size_t countLines(const std::string& source);
     void DFS4Scope(ASTNode* pNode);
   };
 }
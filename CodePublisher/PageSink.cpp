@@ -0,0 +1,680 @@
+/////////////////////////////////////////////////////////////////////
+//  PageSink.cpp - where published pages are stored                //
+//  ver 1.1                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to support code publisher                  //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+
+#include "PageSink.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include "../FileSystem/FileSystem.h"
+
+using namespace CodePublisher;
+
+const char PackIndex::PackMagic[9] = "RCPPACK1";
+const char PackIndex::IndexMagic[9] = "RCPINDEX";
+
+//----< write little endian number >---------------------------------
+
+static void putNumber(std::ostream& out, unsigned long long number, size_t bytes)
+{
+  char buffer[8];
+  for (size_t i = 0; i < bytes; ++i)
+    buffer[i] = static_cast<char>((number >> (8 * i)) & 0xff);
+  out.write(buffer, bytes);
+}
+
+//----< read little endian number >----------------------------------
+
+static unsigned long long getNumber(std::istream& in, size_t bytes)
+{
+  char buffer[8];
+  in.read(buffer, bytes);
+  unsigned long long number = 0;
+  for (size_t i = 0; i < bytes; ++i)
+    number |= static_cast<unsigned long long>(static_cast<unsigned char>(buffer[i])) << (8 * i);
+  return number;
+}
+
+/////////////////////////////////////////////////////////////////////
+// FileSink class members
+
+//----< file spec of a page in the publish directory >--------------
+
+PageSink::File FileSink::fileSpec(const File& file)
+{
+  return FileSystem::Path::getAbsoluteFileSpec(file, root_);
+}
+
+//----< create missing directories of a file spec >-----------------
+/*
+* Workers writing pages of the same new directory may get here at
+* the same time, so creation is serialized.
+*/
+void FileSink::createDirs(const File& fileSpec)
+{
+  std::string path = FileSystem::Path::getPath(fileSpec);
+  if (FileSystem::Directory::exists(path))
+    return;
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  size_t pos = 0;
+  while ((pos = path.find_first_of("\\/", pos + 1)) != std::string::npos)
+  {
+    std::string dir = path.substr(0, pos);
+    if (!FileSystem::Directory::exists(dir))
+      FileSystem::Directory::create(dir);
+  }
+}
+
+//----< write page to its own file, bytes as they are >-------------
+
+bool FileSink::write(const File& file, const std::string& content)
+{
+  File spec = fileSpec(file);
+  createDirs(spec);
+
+  std::ofstream out(spec, std::ios::binary);
+  if (!out.good())
+  {
+    std::cout << "\n  can't open " << spec << "\n\n";
+    return false;
+  }
+  out << content;
+  out.close();
+  return true;
+}
+
+//----< read page file >---------------------------------------------
+
+bool FileSink::read(const File& file, std::string& content)
+{
+  std::ifstream in(fileSpec(file), std::ios::binary);
+  if (!in.good())
+    return false;
+  std::ostringstream text;
+  text << in.rdbuf();
+  content = text.str();
+  return true;
+}
+
+//----< does page file exist? >--------------------------------------
+
+bool FileSink::exists(const File& file)
+{
+  return FileSystem::File::exists(fileSpec(file));
+}
+
+//----< remove page file >-------------------------------------------
+
+bool FileSink::remove(const File& file)
+{
+  return FileSystem::File::remove(fileSpec(file));
+}
+
+/////////////////////////////////////////////////////////////////////
+// MemorySink class members
+
+bool MemorySink::write(const File& file, const std::string& content)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  pages_[file] = content;
+  return true;
+}
+
+bool MemorySink::read(const File& file, std::string& content)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto iter = pages_.find(file);
+  if (iter == pages_.end())
+    return false;
+  content = iter->second;
+  return true;
+}
+
+bool MemorySink::exists(const File& file)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return pages_.find(file) != pages_.end();
+}
+
+bool MemorySink::remove(const File& file)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return pages_.erase(file) > 0;
+}
+
+size_t MemorySink::size()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return pages_.size();
+}
+
+//----< total size of all pages >-----------------------------------
+
+size_t MemorySink::bytes()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  size_t total = 0;
+  for (auto& item : pages_)
+    total += item.second.size();
+  return total;
+}
+
+/////////////////////////////////////////////////////////////////////
+// PackIndex class members
+
+PackIndex::Handles PackIndex::handles_;
+std::mutex PackIndex::handlesMtx_;
+
+//----< copy one page to the end of out, false if it can't be read >-
+
+static bool copyPage(std::istream& in, const PackIndex::Entry& from, std::ostream& out, unsigned long long& end, PackIndex::Entry& to)
+{
+  std::vector<char> buffer(static_cast<size_t>(from.size));
+  in.seekg(static_cast<std::streamoff>(from.offset));
+  if (buffer.size() > 0)
+    in.read(&buffer[0], buffer.size());
+  if (!in.good())
+  {
+    in.clear();
+    return false;
+  }
+  if (buffer.size() > 0)
+    out.write(&buffer[0], buffer.size());
+  to.offset = end;
+  to.size = from.size;
+  end += from.size;
+  return out.good();
+}
+
+//----< write index, sorted by name, and footer at end >-------------
+
+static bool putIndex(std::ostream& out, const PackIndex::Entries& entries, unsigned long long end)
+{
+  std::vector<std::string> files;
+  for (auto& item : entries)
+    files.push_back(item.first);
+  std::sort(files.begin(), files.end());
+
+  for (auto& file : files)
+  {
+    const PackIndex::Entry& entry = entries.at(file);
+    putNumber(out, file.size(), 4);
+    out.write(file.data(), file.size());
+    putNumber(out, entry.offset, 8);
+    putNumber(out, entry.size, 8);
+  }
+  putNumber(out, end, 8);
+  putNumber(out, files.size(), 8);
+  out.write(PackIndex::IndexMagic, 8);
+  out.flush();
+  return out.good();
+}
+
+//----< delete a retired pack when its last index goes away >--------
+
+PackIndex::Handle::~Handle()
+{
+  if (retired.load())
+    std::remove(packFile.c_str());
+}
+
+//----< handle shared by all indexes of a pack file >----------------
+
+std::shared_ptr<PackIndex::Handle> PackIndex::handle(const Path& packFile, bool create)
+{
+  std::lock_guard<std::mutex> lock(handlesMtx_);
+  std::shared_ptr<Handle> pack = handles_[packFile].lock();
+  if (!pack && create)
+  {
+    pack = std::make_shared<Handle>(packFile);
+    handles_[packFile] = pack;
+  }
+  if (!pack)
+    handles_.erase(packFile);
+  return pack;
+}
+
+//----< file of one version of a pack, e.g., publish.3.pack >--------
+
+PackIndex::Path PackIndex::versionFile(const Path& packBase, size_t version)
+{
+  return packBase + "." + std::to_string(version) + ".pack";
+}
+
+//----< versions of a pack found on disk, oldest first >-------------
+
+std::vector<size_t> PackIndex::versions(const Path& packBase)
+{
+  std::string name = FileSystem::Path::getName(packBase);
+  std::vector<size_t> versions;
+  for (auto& file : FileSystem::Directory::getFiles(FileSystem::Path::getPath(packBase), name + ".*.pack"))
+  {
+    if (file.size() <= name.size() + 6)
+      continue;
+    std::string number = file.substr(name.size() + 1, file.size() - name.size() - 6);
+    if (number.find_first_not_of("0123456789") == std::string::npos)
+      versions.push_back(static_cast<size_t>(std::stoul(number)));
+  }
+  std::sort(versions.begin(), versions.end());
+  return versions;
+}
+
+//----< newest version of a pack, empty if none or it's retired >----
+
+PackIndex::Path PackIndex::current(const Path& packBase)
+{
+  std::vector<size_t> found = versions(packBase);
+  if (found.size() == 0)
+    return "";
+  Path packFile = versionFile(packBase, found.back());
+  return retired(packFile) ? "" : packFile;
+}
+
+//----< delete pack now, or when the last index of it goes away >----
+/*
+* Indexes in snapshots may still be sending pages out of the pack,
+* so it stays on disk until they are released.
+*/
+void PackIndex::retire(const Path& packFile)
+{
+  std::shared_ptr<Handle> pack = handle(packFile, false);
+  if (pack)
+    pack->retired.store(true);
+  else
+    std::remove(packFile.c_str());
+}
+
+//----< has pack been retired, but is still in use? >----------------
+
+bool PackIndex::retired(const Path& packFile)
+{
+  std::shared_ptr<Handle> pack = handle(packFile, false);
+  return pack && pack->retired.load();
+}
+
+//----< read index of a pack file, false if it isn't a pack >--------
+/*
+* Each publish appends its index and footer, the last footer in the
+* file is the current index.
+*/
+bool PackIndex::load(const Path& packFile)
+{
+  pack_.reset();
+  entries_.clear();
+  packSize_ = 0;
+
+  std::ifstream in(packFile, std::ios::binary);
+  if (!in.good())
+    return false;
+
+  const std::streamoff footerSize = 8 + 8 + 8;
+  in.seekg(0, std::ios::end);
+  std::streamoff fileSize = in.tellg();
+  if (fileSize < 8 + footerSize)
+    return false;
+
+  in.seekg(fileSize - footerSize);
+  unsigned long long indexOffset = getNumber(in, 8);
+  unsigned long long count = getNumber(in, 8);
+  char magic[8];
+  in.read(magic, 8);
+  if (!in.good() || std::string(magic, 8) != IndexMagic || indexOffset > static_cast<unsigned long long>(fileSize))
+    return false;
+
+  in.seekg(static_cast<std::streamoff>(indexOffset));
+  for (unsigned long long i = 0; i < count && in.good(); ++i)
+  {
+    size_t nameSize = static_cast<size_t>(getNumber(in, 4));
+    std::string name(nameSize, '\0');
+    if (nameSize > 0)
+      in.read(&name[0], nameSize);
+    Entry entry;
+    entry.offset = getNumber(in, 8);
+    entry.size = getNumber(in, 8);
+    entries_[name] = entry;
+  }
+  if (!in.good())
+  {
+    entries_.clear();
+    return false;
+  }
+  pack_ = handle(packFile, true);
+  packSize_ = static_cast<unsigned long long>(fileSize);
+  return true;
+}
+
+//----< find offset and size of a page >-----------------------------
+
+bool PackIndex::find(const File& file, Entry& entry) const
+{
+  auto iter = entries_.find(file);
+  if (iter == entries_.end())
+    return false;
+  entry = iter->second;
+  return true;
+}
+
+//----< read one page out of the pack >------------------------------
+
+bool PackIndex::read(const File& file, std::string& content) const
+{
+  Entry entry;
+  if (!find(file, entry))
+    return false;
+
+  std::ifstream in(packFile(), std::ios::binary);
+  if (!in.good())
+    return false;
+  in.seekg(static_cast<std::streamoff>(entry.offset));
+  content.resize(static_cast<size_t>(entry.size));
+  if (content.size() > 0)
+    in.read(&content[0], content.size());
+  return in.good();
+}
+
+//----< drop a page from this index, the pack isn't changed >--------
+
+bool PackIndex::remove(const File& file)
+{
+  return entries_.erase(file) > 0;
+}
+
+//----< drop all pages under a directory from this index >-----------
+
+size_t PackIndex::removeDir(const File& dir)
+{
+  std::string prefix = dir + "\\";
+  size_t removed = 0;
+  for (auto iter = entries_.begin(); iter != entries_.end(); )
+  {
+    if (iter->first.find(prefix) == 0)
+    {
+      iter = entries_.erase(iter);
+      ++removed;
+    }
+    else
+      ++iter;
+  }
+  return removed;
+}
+
+//----< names of all pages in the pack, sorted >---------------------
+
+PackIndex::Files PackIndex::files() const
+{
+  Files files;
+  for (auto& item : entries_)
+    files.push_back(item.first);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+/////////////////////////////////////////////////////////////////////
+// ArchiveSink class members
+
+//----< start a publish on top of the newest pack >------------------
+
+ArchiveSink::ArchiveSink(const Path& packBase) :
+  packBase_(packBase), tempFile_(packBase + ".tmp"), version_(0), end_(0), committed_(false)
+{
+  std::vector<size_t> versions = PackIndex::versions(packBase_);
+  if (versions.size() > 0)
+    version_ = versions.back();
+  Path current = PackIndex::current(packBase_);
+  if (current.size() > 0)
+    old_.load(current);  // if this fails, commit starts the next version
+
+  temp_.open(tempFile_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!temp_.good())
+  {
+    std::cout << "\n  can't open " << tempFile_ << "\n\n";
+    return;
+  }
+  temp_.write(PackIndex::PackMagic, 8);
+  end_ = 8;
+}
+
+//----< discard temp file of a publish >-----------------------------
+
+ArchiveSink::~ArchiveSink()
+{
+  temp_.close();
+  std::remove(tempFile_.c_str());
+}
+//----< append page to temp file >-----------------------------------
+
+bool ArchiveSink::write(const File& file, const std::string& content)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!temp_.good())
+    return false;
+
+  temp_.seekp(static_cast<std::streamoff>(end_));
+  temp_.write(content.data(), content.size());
+  PackIndex::Entry entry;
+  entry.offset = end_;
+  entry.size = content.size();
+  new_[file] = entry;
+  removed_.erase(file);
+  end_ += content.size();
+  return temp_.good();
+}
+
+//----< read page written now, or kept from previous pack >----------
+
+bool ArchiveSink::read(const File& file, std::string& content)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto iter = new_.find(file);
+  if (iter != new_.end())
+  {
+    temp_.flush();
+    temp_.seekg(static_cast<std::streamoff>(iter->second.offset));
+    content.resize(static_cast<size_t>(iter->second.size));
+    if (content.size() > 0)
+      temp_.read(&content[0], content.size());
+    return temp_.good();
+  }
+  if (removed_.find(file) != removed_.end())
+    return false;
+  return old_.read(file, content);
+}
+
+//----< is page in the new pack? >----------------------------------
+
+bool ArchiveSink::exists(const File& file)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (new_.find(file) != new_.end())
+    return true;
+  PackIndex::Entry entry;
+  return removed_.find(file) == removed_.end() && old_.find(file, entry);
+}
+
+//----< drop page from the new pack >--------------------------------
+
+bool ArchiveSink::remove(const File& file)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  bool found = new_.erase(file) > 0;
+  PackIndex::Entry entry;
+  if (old_.find(file, entry))
+  {
+    removed_.insert(file);
+    found = true;
+  }
+  return found;
+}
+
+//----< copy pages written now to the end of out >-------------------
+
+bool ArchiveSink::copyNew(std::ostream& out, unsigned long long& end, PackIndex::Entries& entries)
+{
+  temp_.flush();
+  for (auto& item : new_)
+  {
+    if (!copyPage(temp_, item.second, out, end, entries[item.first]))
+      return false;
+  }
+  return true;
+}
+
+//----< append pages written now, index and footer to current pack >-
+/*
+* Readers of an older index only look at bytes before its footer, so
+* they can go on sending pages while the pack grows.
+*/
+bool ArchiveSink::append(const PackIndex::Entries& kept)
+{
+  std::fstream pack(old_.packFile(), std::ios::in | std::ios::out | std::ios::binary);
+  if (!pack.good())
+    return compact(kept);
+
+  unsigned long long end = old_.packSize();
+  pack.seekp(static_cast<std::streamoff>(end));
+  PackIndex::Entries entries = kept;
+  if (!copyNew(pack, end, entries))
+    return false;
+  return putIndex(pack, entries, end);
+}
+
+//----< write live pages to the next version, retire older ones >----
+
+bool ArchiveSink::compact(const PackIndex::Entries& kept)
+{
+  Path packFile = PackIndex::versionFile(packBase_, version_ + 1);
+  std::ofstream pack(packFile, std::ios::binary | std::ios::trunc);
+  if (!pack.good())
+  {
+    std::cout << "\n  can't open " << packFile << "\n\n";
+    return false;
+  }
+  pack.write(PackIndex::PackMagic, 8);
+  unsigned long long end = 8;
+  PackIndex::Entries entries;
+  std::ifstream old(old_.packFile(), std::ios::binary);
+  for (auto& item : kept)
+  {
+    PackIndex::Entry entry;
+    if (copyPage(old, item.second, pack, end, entry))
+      entries[item.first] = entry;  // a page that can't be read is left out
+  }
+  old.close();
+
+  if (!copyNew(pack, end, entries) || !putIndex(pack, entries, end))
+  {
+    pack.close();
+    std::remove(packFile.c_str());
+    return false;
+  }
+  pack.close();
+
+  for (auto version : PackIndex::versions(packBase_))
+  {
+    if (version <= version_)
+      PackIndex::retire(PackIndex::versionFile(packBase_, version));
+  }
+  return true;
+}
+
+//----< add pages to the pack, appended or compacted >---------------
+/*
+* The current pack is appended to while at least half of its bytes
+* are live pages; otherwise the live pages are written to a new
+* version, so dead pages don't pile up.
+*/
+bool ArchiveSink::commit()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!temp_.good() || committed_)
+    return false;
+
+  // pages of the current pack that weren't rewritten or removed
+  PackIndex::Entries kept;
+  unsigned long long live = 0;
+  for (auto& item : old_.entries())
+  {
+    if (new_.find(item.first) != new_.end() || removed_.find(item.first) != removed_.end())
+      continue;
+    kept[item.first] = item.second;
+    live += item.second.size;
+  }
+  for (auto& item : new_)
+    live += item.second.size;
+
+  unsigned long long size = old_.packSize() + (end_ - 8);
+  if (old_.loaded() && size - live <= live)
+    committed_ = append(kept);
+  else
+    committed_ = compact(kept);
+  return committed_;
+}
+
+//----< Test Stub >--------------------------------------------------
+
+#ifdef TEST_PAGESINK
+
+#include "../Utilities/Utilities.h"
+
+int main()
+{
+  Utilities::StringHelper::Title("Testing PageSink Classes");
+  Utilities::putline();
+
+  std::string packBase = "./test";
+  std::string body(1000, ' ');
+  {
+    ArchiveSink sink(packBase);
+    sink.write(".\\a.h.htm", "<html>a</html>");
+    sink.write(".\\b.h.htm", "<html>b</html>");
+    sink.write(".\\Dir\\d.h.htm", "<html>d" + body + "</html>");
+    sink.commit();
+  }
+  PackIndex first;
+  first.load(PackIndex::current(packBase));
+  {
+    // second publish rewrites a.h and drops b.h, appended to first pack
+    ArchiveSink sink(packBase);
+    sink.write(".\\a.h.htm", "<html>a, second version</html>");
+    sink.write(".\\c.h.htm", "<html>c</html>");
+    sink.remove(".\\b.h.htm");
+    sink.commit();
+  }
+
+  PackIndex pack;
+  if (!pack.load(PackIndex::current(packBase)))
+  {
+    std::cout << "\n  can't load " << PackIndex::current(packBase) << "\n\n";
+    return 1;
+  }
+  std::cout << "\n  " << pack.packFile() << ", " << pack.packSize() << " bytes";
+  for (auto file : pack.files())
+  {
+    std::string content;
+    pack.read(file, content);
+    std::cout << "\n  " << file << ": " << content.size() << " bytes";
+  }
+  std::string content;
+  first.read(".\\a.h.htm", content);
+  std::cout << "\n  first index still reads: " << content;
+
+  pack.removeDir(".\\Dir");
+  std::cout << "\n  after removeDir: " << pack.files().size() << " pages";
+
+  MemorySink memory;
+  memory.write(".\\a.h.htm", "<html>a</html>");
+  std::cout << "\n  memory sink: " << memory.size() << " pages, " << memory.bytes() << " bytes";
+  std::cout << "\n\n";
+  for (auto version : PackIndex::versions(packBase))
+    PackIndex::retire(PackIndex::versionFile(packBase, version));
+}
+
+#endif
@@ -0,0 +1,246 @@
+#pragma once
+/////////////////////////////////////////////////////////////////////
+//  PageSink.h - where published pages are stored                  //
+//  ver 1.1                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to support code publisher                  //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+/*
+Package Operations:
+==================
+This package defines a PageSink interface the Publisher writes its
+output through, and three sinks:
+- FileSink writes each page to its own file under a publish
+  directory, creating directories as needed. Files are written
+  and read in binary, so a page is stored byte for byte.
+- MemorySink keeps pages in a map, for tests and benchmarks that
+  shouldn't touch the disk
+- ArchiveSink packs all pages into a single file. Pages written
+  during a publish go to a temporary file; commit appends them, a
+  new index and a footer to the end of the current pack, so pages
+  kept from the previous publish aren't copied and offsets held by
+  readers of the old index stay valid.
+Pages are named by path relative to the publish directory, e.g.,
+".\\Dir\\File.h.htm".
+
+Packs are versioned, base.1.pack, base.2.pack, ..., the newest is
+current. When more than half of the current pack is dead, pages
+replaced or removed by later publishes, commit writes the live pages
+to the next version instead and retires the old one.
+
+A PackIndex reads the index of a pack, so a server can send pages
+straight out of it by offset. All indexes of one pack share a handle;
+a retired pack is deleted when the last index that refers to it goes
+away, so pages being sent out of it are never pulled from under a
+reader.
+
+Pack layout, numbers are little endian:
+  "RCPPACK1"                          8 byte magic
+  page bytes ...                      pages, back to back
+  index entries ...                   u32 name size, name, u64 offset, u64 size
+  u64 index offset, u64 entry count   footer
+  "RCPINDEX"                          8 byte magic
+  more page bytes, index and footer   appended by later publishes,
+                                      the last footer is the index
+
+Public Interface:
+=================
+FileSink files(publishPath);               // pages as files
+MemorySink memory;                         // pages in memory
+ArchiveSink archive(packBase);             // pages in base.<n>.pack
+PageSink& sink = archive;
+sink.write(".\\a.h.htm", content);         // store a page
+sink.read(".\\a.h.htm", content);          // get a page back
+sink.exists(".\\a.h.htm");                 // is page stored?
+sink.remove(".\\a.h.htm");                 // drop a page
+sink.commit();                             // finish publish
+PackIndex pack;
+pack.load(PackIndex::current(packBase));   // read index of newest pack
+pack.read(".\\a.h.htm", content);          // read one page by offset
+pack.remove(".\\a.h.htm");                 // drop page from this index
+pack.removeDir(".\\Dir");                  // drop pages of a directory
+PackIndex::retire(pack.packFile());        // delete once unreferenced
+
+Build Process:
+==============
+Required files
+- PageSink.h, PageSink.cpp
+- FileSystem.h, FileSystem.cpp
+
+Maintenance History:
+====================
+ver 1.1 : 19 Oct 2026
+- packs are versioned and appended to, instead of being rewritten
+  and renamed over on each publish
+- PackIndex shares a handle per pack file, and retire deletes a pack
+  once no index refers to it
+- added PackIndex::remove and removeDir
+ver 1.0 : 19 Oct 2026
+- first release
+
+*/
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace CodePublisher
+{
+  ///////////////////////////////////////////////////////////////////
+  // PageSink interface, safe to call from several threads
+
+  class PageSink
+  {
+  public:
+    using File = std::string;
+
+    virtual ~PageSink() {}
+    virtual bool write(const File& file, const std::string& content) = 0;
+    virtual bool read(const File& file, std::string& content) = 0;
+    virtual bool exists(const File& file) = 0;
+    virtual bool remove(const File& file) = 0;
+    virtual bool commit() { return true; }
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  // FileSink class stores each page in its own file
+
+  class FileSink : public PageSink
+  {
+  public:
+    using Path = std::string;
+
+    FileSink(const Path& publishPath) : root_(publishPath) {}
+    bool write(const File& file, const std::string& content);
+    bool read(const File& file, std::string& content);
+    bool exists(const File& file);
+    bool remove(const File& file);
+
+  private:
+    File fileSpec(const File& file);
+    void createDirs(const File& fileSpec);
+
+    Path root_;
+    std::mutex mtx_;  // guards directory creation
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  // MemorySink class keeps pages in a map
+
+  class MemorySink : public PageSink
+  {
+  public:
+    using Pages = std::unordered_map<File, std::string>;
+
+    bool write(const File& file, const std::string& content);
+    bool read(const File& file, std::string& content);
+    bool exists(const File& file);
+    bool remove(const File& file);
+    size_t size();
+    size_t bytes();
+    Pages& pages() { return pages_; }
+
+  private:
+    Pages pages_;
+    std::mutex mtx_;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  // PackIndex class reads the index of a pack file
+
+  class PackIndex
+  {
+  public:
+    using Path = std::string;
+    using File = std::string;
+    using Files = std::vector<File>;
+
+    struct Entry
+    {
+      unsigned long long offset;
+      unsigned long long size;
+    };
+    using Entries = std::unordered_map<File, Entry>;
+
+    static const char PackMagic[9];
+    static const char IndexMagic[9];
+
+    static Path versionFile(const Path& packBase, size_t version);
+    static std::vector<size_t> versions(const Path& packBase);
+    static Path current(const Path& packBase);
+    static void retire(const Path& packFile);
+    static bool retired(const Path& packFile);
+
+    bool load(const Path& packFile);
+    bool loaded() const { return pack_ != nullptr; }
+    bool find(const File& file, Entry& entry) const;
+    bool read(const File& file, std::string& content) const;
+    bool remove(const File& file);
+    size_t removeDir(const File& dir);
+    Files files() const;
+    const Entries& entries() const { return entries_; }
+    Path packFile() const { return pack_ ? pack_->packFile : Path(); }
+    unsigned long long packSize() const { return packSize_; }
+
+  private:
+    struct Handle
+    {
+      Path packFile;
+      std::atomic<bool> retired;
+      Handle(const Path& file) : packFile(file), retired(false) {}
+      ~Handle();
+    };
+    using Handles = std::unordered_map<Path, std::weak_ptr<Handle>>;
+    static std::shared_ptr<Handle> handle(const Path& packFile, bool create);
+    static Handles handles_;
+    static std::mutex handlesMtx_;
+
+    std::shared_ptr<Handle> pack_;   // shared by all indexes of the pack
+    Entries entries_;
+    unsigned long long packSize_ = 0;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  // ArchiveSink class stores all pages in a single pack file
+
+  class ArchiveSink : public PageSink
+  {
+  public:
+    using Path = std::string;
+
+    ArchiveSink(const Path& packBase);
+    ~ArchiveSink();
+    bool write(const File& file, const std::string& content);
+    bool read(const File& file, std::string& content);
+    bool exists(const File& file);
+    bool remove(const File& file);
+    bool commit();
+
+  private:
+    ArchiveSink(const ArchiveSink&) = delete;
+    ArchiveSink& operator=(const ArchiveSink&) = delete;
+
+    bool append(const PackIndex::Entries& kept);
+    bool compact(const PackIndex::Entries& kept);
+    bool copyNew(std::ostream& out, unsigned long long& end, PackIndex::Entries& entries);
+
+    Path packBase_;
+    Path tempFile_;
+    size_t version_;                   // of the current pack, 0 if none
+    PackIndex old_;                    // current pack
+    PackIndex::Entries new_;           // pages written to temp file
+    std::unordered_set<File> removed_; // pages dropped from previous pack
+    std::fstream temp_;
+    unsigned long long end_;
+    bool committed_;
+    std::mutex mtx_;
+  };
+}
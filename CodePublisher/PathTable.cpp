@@ -0,0 +1,161 @@
+/////////////////////////////////////////////////////////////////////
+//  PathTable.cpp - interned paths with cached relative paths      //
+//  ver 1.0                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to support code publisher                  //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+
+#include "PathTable.h"
+#include "../FileSystem/FileSystem.h"
+
+using namespace CodePublisher;
+
+static const PathTable::Id NoDir = static_cast<PathTable::Id>(-1);
+
+//----< PathTable constructor, root directory is always there >------
+
+PathTable::PathTable()
+{
+  internDir(".\\");
+}
+
+//----< parent of a directory, e.g., .\A\ for .\A\B\ >---------------
+
+PathTable::Path PathTable::parentDir(const Path& dir)
+{
+  if (dir.size() < 2)
+    return ".\\";
+  size_t pos = dir.find_last_of('\\', dir.size() - 2);
+  if (pos == std::string::npos)
+    return ".\\";
+  return dir.substr(0, pos + 1);
+}
+
+//----< id of a directory, interning it and its parents >------------
+
+PathTable::Id PathTable::internDir(const Path& dir)
+{
+  auto iter = dirIds_.find(dir);
+  if (iter != dirIds_.end())
+    return iter->second;
+
+  DirInfo info;
+  info.path = dir;
+  info.parent = 0;
+  info.depth = 0;
+  if (dir != ".\\")
+  {
+    info.parent = internDir(parentDir(dir));
+    info.depth = dirs_[info.parent].depth + 1;
+  }
+  Id id = dirs_.size();
+  dirs_.push_back(info);
+  dirIds_[dir] = id;
+  return id;
+}
+
+//----< directory and name of a file, interning it >-----------------
+/*
+* Files outside the publish root, not starting with .\, get no
+* directory.
+*/
+const PathTable::FileInfo* PathTable::internFile(const File& file)
+{
+  auto iter = fileIds_.find(file);
+  if (iter != fileIds_.end())
+    return &files_[iter->second];
+
+  FileInfo info;
+  info.name = FileSystem::Path::getName(file);
+  info.dir = NoDir;
+  if (file.find(".\\") == 0)
+    info.dir = internDir(file.substr(0, file.size() - info.name.size()));
+  fileIds_[file] = files_.size();
+  files_.push_back(info);
+  return &files_.back();
+}
+
+//----< relative path between two directories, computed once >-----
+/*
+* Both directories walk up to their common ancestor. The result
+* climbs out of from with ..\ and goes down to to, or starts with .\
+* if to is inside from.
+*/
+const std::string& PathTable::relativeDir(Id from, Id to)
+{
+  unsigned long long key = (static_cast<unsigned long long>(from) << 32) | to;
+  auto iter = relative_.find(key);
+  if (iter != relative_.end())
+    return iter->second;
+
+  Id a = from, b = to;
+  while (dirs_[a].depth > dirs_[b].depth)
+    a = dirs_[a].parent;
+  while (dirs_[b].depth > dirs_[a].depth)
+    b = dirs_[b].parent;
+  while (a != b)
+  {
+    a = dirs_[a].parent;
+    b = dirs_[b].parent;
+  }
+
+  size_t ups = dirs_[from].depth - dirs_[a].depth;
+  std::string path;
+  if (ups == 0)
+    path = ".\\";
+  for (size_t i = 0; i < ups; ++i)
+    path += "..\\";
+  path += dirs_[to].path.substr(dirs_[a].path.size());
+  return relative_[key] = path;
+}
+
+//----< path of file to, relative to file from >---------------------
+
+std::string PathTable::relative(const File& from, const File& to)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  const FileInfo* fromInfo = internFile(from);
+  const FileInfo* toInfo = internFile(to);
+  if (fromInfo->dir == NoDir || toInfo->dir == NoDir)
+    return FileSystem::Path::getRelativeFromFileToFile(from, to);
+  return relativeDir(fromInfo->dir, toInfo->dir) + toInfo->name;
+}
+
+//----< file name with extension >-----------------------------------
+
+const std::string& PathTable::name(const File& file)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return internFile(file)->name;
+}
+
+//----< Test Stub >--------------------------------------------------
+
+#ifdef TEST_PATHTABLE
+
+#include <iostream>
+
+int main()
+{
+  PathTable paths;
+  std::pair<std::string, std::string> links[] = {
+    { ".\\a.h", ".\\template.css" },
+    { ".\\A\\a.h", ".\\template.css" },
+    { ".\\A\\a.h", ".\\A\\b.h" },
+    { ".\\A\\B\\a.h", ".\\A\\C\\c.h" },
+    { ".\\A\\a.h", ".\\A\\B\\C\\c.h" },
+    { ".\\A\\B\\C\\a.h", ".\\D\\d.h" }
+  };
+  for (auto& link : links)
+  {
+    std::cout << "\n  " << link.first << " -> " << link.second << ": "
+      << paths.relative(link.first, link.second);
+  }
+  std::cout << "\n  name of .\\A\\B\\a.h: " << paths.name(".\\A\\B\\a.h");
+  std::cout << "\n\n";
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+/////////////////////////////////////////////////////////////////////
+//  PathTable.h - interned paths with cached relative paths        //
+//  ver 1.0                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to support code publisher                  //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+/*
+Package Operations:
+==================
+This package defines a PathTable class for the links of published
+pages. Files and directories, named relative to the publish root,
+e.g., ".\\A\\a.h" and ".\\A\\", are interned once, each directory
+with its parent and depth. The relative path from one directory to
+another is computed once per pair, by walking both up to their
+common ancestor, and memoized, so a link between two files costs two
+lookups and a string append.
+Relative paths have the form Path::getRelativeFromFileToFile gives,
+".\\b.h" in the same directory and "..\\B\\b.h" elsewhere.
+All methods may be called from several threads.
+
+Public Interface:
+=================
+PathTable paths;
+std::string link = paths.relative(".\\A\\a.h", ".\\B\\b.h");  // "..\\B\\b.h"
+const std::string& name = paths.name(".\\A\\a.h");            // "a.h"
+std::string parent = PathTable::parentDir(".\\A\\B\\");        // ".\\A\\"
+
+Build Process:
+==============
+Required files
+- PathTable.h, PathTable.cpp
+- FileSystem.h, FileSystem.cpp
+
+Maintenance History:
+====================
+ver 1.0 : 19 Oct 2026
+- first release
+
+*/
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace CodePublisher
+{
+  ///////////////////////////////////////////////////////////////////
+  // PathTable class interns files and directories
+
+  class PathTable
+  {
+  public:
+    using Path = std::string;
+    using File = std::string;
+    using Id = size_t;
+
+    PathTable();
+    std::string relative(const File& from, const File& to);
+    const std::string& name(const File& file);
+    static Path parentDir(const Path& dir);
+
+  private:
+    struct DirInfo
+    {
+      Path path;     // e.g., ".\\A\\B\\"
+      Id parent;
+      size_t depth;  // 0 for the root ".\\"
+    };
+    struct FileInfo
+    {
+      Id dir;
+      std::string name;
+    };
+
+    Id internDir(const Path& dir);
+    const FileInfo* internFile(const File& file);
+    const std::string& relativeDir(Id from, Id to);
+
+    std::deque<DirInfo> dirs_;  // deques keep references valid as they grow
+    std::deque<FileInfo> files_;
+    std::unordered_map<Path, Id> dirIds_;
+    std::unordered_map<File, Id> fileIds_;
+    std::unordered_map<unsigned long long, std::string> relative_;  // from, to -> relative path
+    std::mutex mtx_;
+  };
+}
@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////
 //  ScopeTable.cpp - a data structure that store scope start & end //
-//  ver 1.0                                                        //
+//  ver 1.2                                                        //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to support code publisher                  //
@@ -10,6 +10,7 @@
 
 #include "ScopeTable.h"
 #include <iostream>
+#include <algorithm>
 
 using namespace CodePublisher;
 
@@ -17,50 +18,80 @@ using namespace CodePublisher;
 
 void ScopeTable::addStartLine(File file, size_t lineNo)
 {
-  _store[file][lineNo] = ScopeType::start;
+  _store[file].push_back(Mark{ lineNo, ScopeType::start });
 }
 
 //----< add 'lineNo' as scope end line in 'file'  >------------------
 
 void ScopeTable::addEndLine(File file, size_t lineNo)
 {
-  _store[file][lineNo] = ScopeType::end;
+  _store[file].push_back(Mark{ lineNo, ScopeType::end });
 }
 
-//----< get the scope type of 'lineNo' in 'file' >-------------------
-
-ScopeTable::ScopeType ScopeTable::lineType(File file, size_t lineNo)
+//----< sort marks of each file by line number >---------------------
+/*
+* When a line was marked more than once, the last mark added wins,
+* as it did when marks were stored in a map.
+*/
+void ScopeTable::freeze()
 {
-  if (_store.find(file) == _store.end())
-  {
-    return ScopeType::none;  // file does not exist
-  }
-  else
+  for (auto& item : _store)
   {
-    ScopeTableOne& scopeTableOne = _store[file];
+    Marks& marks = item.second;
+    std::stable_sort(marks.begin(), marks.end(),
+      [](const Mark& a, const Mark& b) { return a.lineNo < b.lineNo; });
 
-    if (scopeTableOne.find(lineNo) == scopeTableOne.end())
+    Marks unique;
+    for (auto& mark : marks)
     {
-      return ScopeType::none;  // not scope start, not scope end
-    }
-    else
-    {
-      return scopeTableOne[lineNo];
+      if (unique.size() > 0 && unique.back().lineNo == mark.lineNo)
+        unique.back() = mark;
+      else
+        unique.push_back(mark);
     }
+    marks.swap(unique);
   }
 }
 
+//----< get sorted marks of 'file', empty if it has none >-----------
+
+const ScopeTable::Marks& ScopeTable::marks(const File& file) const
+{
+  static const Marks noMarks;
+  auto iter = _store.find(file);
+  if (iter == _store.end())
+    return noMarks;
+  return iter->second;
+}
+
+//----< get the scope type of 'lineNo' in 'file' >-------------------
+/*
+* Binary search of the file's marks, valid after freeze. Only reads
+* the table, so it's safe to call from several threads.
+*/
+ScopeTable::ScopeType ScopeTable::lineType(const File& file, size_t lineNo) const
+{
+  const Marks& fileMarks = marks(file);
+  auto iter = std::lower_bound(fileMarks.begin(), fileMarks.end(), lineNo,
+    [](const Mark& mark, size_t line) { return mark.lineNo < line; });
+
+  if (iter == fileMarks.end() || iter->lineNo != lineNo)
+    return ScopeType::none;  // not scope start, not scope end
+
+  return iter->type;
+}
+
 //----< show content in scope table >--------------------------------
 
 void ScopeTable::show()
 {
-  for (auto scopeTableOne : _store)
+  for (auto& item : _store)
   {
-    std::cout << "\n  File: " << scopeTableOne.first.c_str();
+    std::cout << "\n  File: " << item.first.c_str();
 
-    for (auto item : scopeTableOne.second)
+    for (auto& mark : item.second)
     {
-      std::cout << "\n  line: " << item.first << " type: " << item.second;
+      std::cout << "\n  line: " << mark.lineNo << " type: " << mark.type;
     }
   }
 
@@ -81,6 +112,7 @@ int main()
   ScopeTable table;
   table.addStartLine(".\\file.h", 1);
   table.addEndLine(".\\file.h", 3);
+  table.freeze();
 
   table.show();
 
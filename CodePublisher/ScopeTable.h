@@ -1,7 +1,7 @@
 #pragma once
 /////////////////////////////////////////////////////////////////////
 //  ScopeTable.h - a data structure that store scope start & end   //
-//  ver 1.0                                                        //
+//  ver 1.2                                                        //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to support code publisher                  //
@@ -14,12 +14,17 @@ Package Operations:
 This package defines a ScopeTable class.
 Those provides support for storing scope start and end line numbers 
 during source code publishing.
+Each file's marks are kept in one vector. After all marks are added,
+freeze sorts them by line, so a publisher can walk a file's marks
+with a cursor while it emits lines, instead of looking up every line.
 
 Public Interface:
 =================
 ScopeTable table;                                  // create a scope talbe instance
 table.addStartLine(".\\file1.h", 1);               // record scope start line 1
 table.addEndLine(".\\file1.h", 2);                 // record scope end line 2
+table.freeze();                                    // sort marks, call before queries
+const Marks& marks = table.marks(".\\file1.h");    // sorted marks of file1.h
 ScopeType type = table.lineType(".\\file1.h", 1);  // get type of line 1 in file1.h
 table.show();                                      // a simplified show of table content
 
@@ -30,11 +35,17 @@ Required files
 
 Maintenance History:
 ====================
+ver 1.2 : 19 Oct 2026
+- store each file's marks in a sorted vector instead of a hash map
+ver 1.1 : 19 Oct 2026
+- lineType is const, so publishing threads can share one table
 ver 1.0 : 08 Apr 2017
 - first release
 
 */
 
+#include <string>
+#include <vector>
 #include <unordered_map>
 
 namespace CodePublisher
@@ -47,15 +58,23 @@ namespace CodePublisher
   public:
     enum ScopeType { none, start, end };
 
+    struct Mark
+    {
+      size_t lineNo;
+      ScopeType type;
+    };
+
     using File = std::string;
-    using ScopeTableOne = std::unordered_map<size_t, ScopeType>;
+    using Marks = std::vector<Mark>;
 
     void addStartLine(File file, size_t lineNo);
     void addEndLine(File file, size_t lineNo);
-    ScopeType lineType(File file, size_t lineNo);
+    void freeze();
+    const Marks& marks(const File& file) const;
+    ScopeType lineType(const File& file, size_t lineNo) const;
     void show();  // show table content
 
   private:
-    std::unordered_map<File, ScopeTableOne> _store;
+    std::unordered_map<File, Marks> _store;
   };
 }
\ No newline at end of file
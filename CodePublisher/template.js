@@ -13,4 +13,155 @@ function btn(id) {
         unfold.style.display = '';
         fold.style.display = 'none';
     }
+}
+
+// compact pages keep their code in one <pre id="code"> and call
+// initFolds with [start, end] line pairs of the foldable scopes
+var codeLines = [];
+var codeFolds = [];
+var folded = [];
+
+function initFolds(folds) {
+    var code = document.getElementById('code');
+    codeLines = code.innerHTML.split('\n');
+    if (codeLines.length > 0 && codeLines[codeLines.length - 1] === '')
+        codeLines.pop();
+    codeFolds = folds;
+    folded = [];
+    for (var k = 0; k < folds.length; k++)
+        folded.push(false);
+
+    code.onclick = function (e) {
+        var target = e.target || e.srcElement;
+        var fold = target.getAttribute('data-fold');
+        if (fold !== null) {
+            folded[fold] = !folded[fold];
+            renderCode();
+        }
+    };
+    renderCode();
+}
+
+function lineNumber(n) {
+    var text = '' + n;
+    while (text.length < 3)
+        text = ' ' + text;
+    return text;
+}
+
+function renderCode() {
+    var starts = {};
+    var ends = {};
+    for (var k = 0; k < codeFolds.length; k++) {
+        starts[codeFolds[k][0]] = k;
+        ends[codeFolds[k][1]] = true;
+    }
+
+    var html = [];
+    var depth = 0;
+    for (var n = 1; n <= codeLines.length; n++) {
+        var text = codeLines[n - 1];
+        if (n in starts) {
+            var fold = starts[n];
+            var button = ' <span class="fold" data-fold="' + fold + '">';
+            if (folded[fold]) {
+                html.push(lineNumber(n) + button + '[+]</span>  ' + text + ' ...');
+                n = codeFolds[fold][1];
+                continue;
+            }
+            html.push(lineNumber(n) + button + '[-]</span>  ' + text);
+            depth++;
+        }
+        else if (ends[n] && depth > 0) {
+            html.push(lineNumber(n) + '  -   ' + text);
+            depth--;
+        }
+        else
+            html.push(lineNumber(n) + (depth > 0 ? '  |   ' : '      ') + text);
+    }
+    document.getElementById('code').innerHTML = html.join('\n');
+}
+
+// chunked pages get their code a chunk at a time, as chunk files are
+// loaded with script tags, which also works for pages opened from disk
+var chunkBase = '';
+var chunkState = [];  // 0 not loaded, 1 loading, 2 loaded
+var chunkTries = [];
+
+function initChunks(base, count, linesPerChunk, totalLines) {
+    chunkBase = base;
+    var div = document.getElementById('chunks');
+    for (var n = 0; n < count; n++) {
+        var pre = document.createElement('pre');
+        pre.id = 'chunk' + n;
+        var lines = Math.min(linesPerChunk, totalLines - n * linesPerChunk);
+        pre.style.height = (lines * 1.2) + 'em';
+        div.appendChild(pre);
+        chunkState.push(0);
+        chunkTries.push(0);
+    }
+    window.onscroll = loadVisibleChunks;
+    window.onresize = loadVisibleChunks;
+    loadVisibleChunks();
+}
+
+function loadVisibleChunks() {
+    var margin = window.innerHeight;
+    for (var n = 0; n < chunkState.length; n++) {
+        if (chunkState[n] !== 0)
+            continue;
+        var rect = document.getElementById('chunk' + n).getBoundingClientRect();
+        if (rect.bottom > -margin && rect.top < window.innerHeight + margin)
+            loadChunk(n);
+    }
+}
+
+function loadChunk(n) {
+    chunkState[n] = 1;
+    var head = document.getElementsByTagName('head')[0];
+    var script = document.createElement('script');
+    script.src = chunkBase + '.chunk' + n + '.js';
+    script.onerror = function () {
+        // chunk may still be on its way from the server, try again,
+        // a few times, the server may not have it
+        head.removeChild(script);
+        if (++chunkTries[n] >= 3)
+            return;
+        chunkState[n] = 0;
+        setTimeout(loadVisibleChunks, 500);
+    };
+    head.appendChild(script);
+}
+
+function chunk(n, html) {
+    var pre = document.getElementById('chunk' + n);
+    pre.innerHTML = html;
+    pre.style.height = '';
+    chunkState[n] = 2;
+}
+
+// index pages search the file and type names listed in search.js,
+// searchNames holds [name, page] pairs, page indexes searchPages
+var searchRoot = '';
+
+function initSearch(root) {
+    searchRoot = root;
+}
+
+function search(text) {
+    var results = document.getElementById('results');
+    text = text.toLowerCase();
+    if (text.length === 0 || typeof searchNames === 'undefined') {
+        results.innerHTML = '';
+        return;
+    }
+    var html = [];
+    for (var k = 0; k < searchNames.length && html.length < 100; k++) {
+        var name = searchNames[k][0];
+        if (name.toLowerCase().indexOf(text) < 0)
+            continue;
+        var page = searchPages[searchNames[k][1]];
+        html.push('<a href="' + searchRoot + page.substring(2) + '.htm">' + name + '</a>  ' + page);
+    }
+    results.innerHTML = html.join('<br>\n');
 }
\ No newline at end of file
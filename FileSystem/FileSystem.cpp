@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////////////
 // FileSystem.cpp - Support file and directory operations                  //
-// ver 2.7                                                                 //
+// ver 2.8                                                                 //
 // ----------------------------------------------------------------------- //
 // copyright ?Jim Fawcett, 2012                                           //
 // All rights granted provided that this notice is retained                //
@@ -401,11 +401,17 @@ std::string FileInfo::intToString(long i)
 //----< return file date >---------------------------------------------
 
 std::string FileInfo::date(dateFormat df) const
+{
+  return toDate(data.ftLastWriteTime, df);
+}
+//----< format a file time as local date and time >--------------------
+
+std::string FileInfo::toDate(const FILETIME& fileTime, dateFormat df)
 {
   std::string dateStr, timeStr;
   FILETIME ft;
   SYSTEMTIME st;
-  ::FileTimeToLocalFileTime(&data.ftLastWriteTime, &ft);
+  ::FileTimeToLocalFileTime(&fileTime, &ft);
   ::FileTimeToSystemTime(&ft, &st);
   dateStr = intToString(st.wMonth) + '/' + intToString(st.wDay) + '/' + intToString(st.wYear);
   timeStr = intToString(st.wHour) + ':' + intToString(st.wMinute) + ':' + intToString(st.wSecond);
@@ -725,6 +731,35 @@ std::vector<std::string> Directory::getDirectories(const std::string& path, cons
   }
   return dirs;
 }
+//----< get names, dates, and types of all entries in one pass >----------
+/*
+ * path should be absolute; the current directory isn't used, so this
+ * may run on several threads at once.  "." and ".." are skipped.
+ */
+std::vector<DirEntry> Directory::getEntries(const std::string& path, const std::string& pattern)
+{
+  std::vector<DirEntry> entries;
+  WIN32_FIND_DATAA data;
+  HANDLE hFind = ::FindFirstFileExA(
+    Path::fileSpec(path, pattern).c_str(), FindExInfoBasic, &data,
+    FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH
+  );
+  if(hFind == INVALID_HANDLE_VALUE)
+    return entries;
+  do
+  {
+    std::string name = data.cFileName;
+    if(name == "." || name == "..")
+      continue;
+    DirEntry entry;
+    entry.name = name;
+    entry.date = FileInfo::toDate(data.ftLastWriteTime);
+    entry.isDir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    entries.push_back(entry);
+  } while(::FindNextFileA(hFind, &data));
+  ::FindClose(hFind);
+  return entries;
+}
 //----< create directory >-------------------------------------------------
 
 bool Directory::create(const std::string& path)
@@ -923,6 +958,12 @@ int main(int argc, char* argv[])
     std::cout << "\n    " << currdirs[i].c_str();
   std::cout << "\n";
 
+  std::cout << "\n  entries of c:/temp/, in one pass:";
+  std::vector<DirEntry> entries = Directory::getEntries("c:/temp/");
+  for (auto& entry : entries)
+    std::cout << "\n    " << entry.name << (entry.isDir ? "\\" : "") << "  " << entry.date;
+  std::cout << "\n";
+
   // Create directory
 
   title("Demonstrate FileInfo Class Operations", '=');
@@ -2,7 +2,7 @@
 #define FILESYSTEM_H
 /////////////////////////////////////////////////////////////////////////////
 // FileSystem.h - Support file and directory operations                    //
-// ver 2.7                                                                 //
+// ver 2.8                                                                 //
 // ----------------------------------------------------------------------- //
 // copyright ?Jim Fawcett, 2012                                           //
 // All rights granted provided that this notice is retained                //
@@ -38,7 +38,9 @@
  * The Directory class supports getting filenames or directories from a 
  * fully qualified filespec, e.g., path + filename pattern using static
  * methods.  It also provides non-static methods to get and set the current
- * directory.
+ * directory.  Directory::getEntries lists names, dates, and types of all
+ * entries of a directory, given by absolute path, in one pass, without
+ * using the current directory, which is shared by all threads.
  *
  * Public Interface:
  * =================
@@ -71,6 +73,7 @@
  * d.setCurrentDirectory(dir);
  * std::vector<std::string> files = Directory::getFiles(path, pattern);
  * std::vector<std::string> dirs = Directory::getDirectories(path);
+ * std::vector<DirEntry> entries = Directory::getEntries(path);
  * 
  * Required Files:
  * ===============
@@ -82,6 +85,8 @@
  *
  * Maintenance History:
  * ====================
+ * ver 2.8 : 19 Oct 26
+ * - added Directory::getEntries(...) and FileInfo::toDate(...)
  * ver 2.7 : 07 Apr 17
  * - added get relative & absolute path functions
  * ver 2.6 : 04 Apr 15
@@ -193,6 +198,7 @@ namespace FileSystem
     bool good();
     std::string name() const;
     std::string date(dateFormat df=fullformat) const;
+    static std::string toDate(const FILETIME& fileTime, dateFormat df=fullformat);
     size_t size() const;
     
     bool isArchive() const;
@@ -238,6 +244,16 @@ namespace FileSystem
     static std::string toUpper(const std::string& src);
   };
   
+  /////////////////////////////////////////////////////////
+  // DirEntry, one entry of a directory listing
+
+  struct DirEntry
+  {
+    std::string name;
+    std::string date;  // as FileInfo::date() gives it
+    bool isDir;
+  };
+
   /////////////////////////////////////////////////////////
   // Directory
 
@@ -251,6 +267,7 @@ namespace FileSystem
     static bool setCurrentDirectory(const std::string& path);
     static std::vector<std::string> getFiles(const std::string& path=".", const std::string& pattern="*.*");
     static std::vector<std::string> getDirectories(const std::string& path=".", const std::string& pattern="*.*");
+    static std::vector<DirEntry> getEntries(const std::string& path, const std::string& pattern="*.*");
   private:
     //static const int BufSize = 255;
     //char buffer[BufSize];
@@ -1,6 +1,6 @@
 ﻿/////////////////////////////////////////////////////////////////////
 //  Server.cpp - Remote Code Publisher Server                      //
-//  ver 1.0                                                        //
+//  ver 2.17                                                       //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform remote code publisher           //
@@ -15,9 +15,12 @@
 #include "../Utilities/Utilities.h"
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <cstring>
 #include "../CodePublisher/CodePublisher.h"
 #include "../Analyzer/Executive.h"
 #include "../Analyzer/TypeAnal.h"
+#include "../Parser/ConfigureParser.h"
 
 using Show = StaticLogger<0>;
 using namespace Utilities;
@@ -30,6 +33,7 @@ void ClientHandler::showUsage()
   out << "\n  Usage:";
   out << "\n  Command Line Arguments are:";
   out << "\n  - 1st: path to subdirectory to store source files";
+  out << "\n  - 2nd: optional /reactor, serve clients from a worker pool";
   //out << "\n  - 2st: path to subdirectory to store published html files";
   //out << "\n  - 3st: server port number. default: 8080";
 
@@ -37,6 +41,220 @@ void ClientHandler::showUsage()
   std::cout << out.str();
 }
 
+//----< options as a string, equal for equal options >--------------
+
+std::string PublishOptions::key() const
+{
+  std::ostringstream out;
+  out << fast << compactFolds << chunkLines << ";" << packed << highlight;
+  return out.str();
+}
+
+//----< open outlet, messages go out with send >---------------------
+
+void Outlet::open(Send send)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  send_ = send;
+  std::lock_guard<std::mutex> queueLock(queueMtx_);
+  open_ = true;
+}
+//----< close outlet, dropping messages not yet sent >---------------
+
+void Outlet::close()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  send_ = nullptr;
+  std::lock_guard<std::mutex> queueLock(queueMtx_);
+  open_ = false;
+  pending_.clear();
+}
+//----< queue message, sending it now if the handler is idle >-------
+/*
+* Returns false once the outlet is closed. Never waits for the
+* handler, which sends the message after its reply.
+*/
+bool Outlet::send(const HttpMessage& msg)
+{
+  {
+    std::lock_guard<std::mutex> queueLock(queueMtx_);
+    if (!open_)
+      return false;
+    pending_.push_back(msg);
+  }
+  flush();
+  return true;
+}
+//----< send queued messages, unless another thread holds the lock >-
+/*
+* The thread holding the lock looks at the queue again after letting
+* go, so a message queued while it was sending isn't left behind.
+*/
+void Outlet::flush()
+{
+  while (true)
+  {
+    std::unique_lock<std::mutex> lock(mtx_, std::try_to_lock);
+    if (!lock.owns_lock())
+      return;
+    std::vector<HttpMessage> messages;
+    {
+      std::lock_guard<std::mutex> queueLock(queueMtx_);
+      messages.swap(pending_);
+    }
+    for (auto& msg : messages)
+    {
+      if (send_)
+        send_(msg);
+    }
+    lock.unlock();
+
+    std::lock_guard<std::mutex> queueLock(queueMtx_);
+    if (pending_.empty())
+      return;
+  }
+}
+//----< start the thread that runs publish jobs >--------------------
+
+PublishQueue::PublishQueue()
+{
+  thread_ = std::thread([this] { runJobs(); });
+}
+
+//----< run jobs still queued, then stop >----------------------------
+
+PublishQueue::~PublishQueue()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+//----< queue a job, or join a queued one, returns its id >----------
+/*
+* outlet may be null for jobs no client waits on.
+*/
+size_t PublishQueue::submit(const std::string& key, OutletPtr outlet, const EndPoint& ep, Run run)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (auto& job : jobs_)
+  {
+    if (job.key == key)
+    {
+      if (outlet)
+        job.clients.push_back(PublishJob::Client(outlet, ep));
+      return job.id;
+    }
+  }
+  PublishJob job;
+  job.id = nextId_++;
+  job.key = key;
+  job.run = run;
+  if (outlet)
+    job.clients.push_back(PublishJob::Client(outlet, ep));
+  jobs_.push_back(job);
+  cv_.notify_one();
+  return jobs_.back().id;
+}
+
+//----< job thread, runs one job at a time in order >----------------
+
+void PublishQueue::runJobs()
+{
+  while (true)
+  {
+    PublishJob job;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cv_.wait(lock, [this] { return stop_ || jobs_.size() > 0; });
+      if (jobs_.size() == 0)
+        return;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job.run(job);
+  }
+}
+
+//----< stop the watcher >--------------------------------------------
+
+ListingCache::~ListingCache()
+{
+  if (watcher_.joinable())
+  {
+    ::SetEvent(stop_);
+    watcher_.join();
+  }
+  if (stop_ != NULL)
+    ::CloseHandle(stop_);
+}
+//----< cached listing for key, if there is one >--------------------
+
+bool ListingCache::find(const std::string& key, std::string& body)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto iter = listings_.find(key);
+  if (iter == listings_.end())
+    return false;
+  body = iter->second;
+  return true;
+}
+//----< count of changes, read before making a listing >-------------
+
+size_t ListingCache::generation()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return generation_;
+}
+//----< keep a listing, unless there were changes while it was made >
+
+void ListingCache::store(const std::string& key, const std::string& body, size_t generation)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (generation == generation_)
+    listings_[key] = body;
+}
+//----< forget all listings >----------------------------------------
+
+void ListingCache::invalidate()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  ++generation_;
+  listings_.clear();
+}
+//----< start a thread clearing listings on changes under root >-----
+/*
+* Changes to names and write times, of files and directories, in the
+* whole tree count. Notifications come in bursts while files are
+* written, each just clears the cache again.
+*/
+void ListingCache::watch(const std::string& root)
+{
+  if (watcher_.joinable())
+    return;
+  HANDLE change = ::FindFirstChangeNotificationA(root.c_str(), TRUE,
+    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+  if (change == INVALID_HANDLE_VALUE)
+  {
+    Show::write("\n  can't watch " + root + ", listings are cleared only by requests");
+    return;
+  }
+  stop_ = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+  watcher_ = std::thread([this, change] {
+    HANDLE handles[] = { change, stop_ };
+    while (::WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0)
+    {
+      invalidate();
+      if (!::FindNextChangeNotification(change))
+        break;
+    }
+    ::FindCloseChangeNotification(change);
+  });
+}
 //----< handle command line arguments >------------------------------
 /*
 * Arguments are:
@@ -60,6 +278,9 @@ bool ClientHandler::ProcessCommandLine(int argc, char* argv[])
       FileSystem::Directory::create(rootPath_);
     }
     std::cout << "\n  Code Repo Path: " << rootPath_ << "\n";
+    std::string pack = PackIndex::current(packBase());
+    shared_->update([pack](AnalysisState& state) { AnalysisState::change(state.pack).load(pack); });
+    listings_->watch(rootPath_);
   }
   catch (std::exception& ex)
   {
@@ -103,7 +324,10 @@ HttpMessage ClientHandler::readMessage(Socket& socket)
       else
         return msg;
 
-      readFile(msg.findValue("path"), contentSize, socket);
+      std::string path = msg.findValue("path");
+      if (readFile(path, contentSize, socket))
+        updateDeps(FileSystem::Path::getFullFileSpec(path));
+      listings_->invalidate();
     } else {
       // read message body
       size_t numBytes = 0;
@@ -122,11 +346,43 @@ HttpMessage ClientHandler::readMessage(Socket& socket)
   }
   return msg;
 }
+//----< build message from a frame a reactor has read >--------------
+/*
+* The same as readMessage, but the body is already in memory. A file
+* body is saved at once, so the returned message has no body.
+*/
+HttpMessage ClientHandler::frameMessage(Reactor::Frame& frame)
+{
+  HttpMessage msg;
+  std::istringstream header(frame.header);
+  std::string attribString;
+  while (std::getline(header, attribString))
+  {
+    if (attribString.size() <= 1) break;
+    msg.addAttribute(HttpMessage::parseAttribute(attribString));
+  }
+  if (msg.attributes().size() == 0 || msg.attributes()[0].first != "POST")
+    return msg;
+
+  if (msg.findValue("file") != "")
+  {
+    if (msg.findValue("content-length") == "")
+      return msg;
+    std::string path = msg.findValue("path");
+    if (writeFile(path, frame.body))
+      updateDeps(FileSystem::Path::getFullFileSpec(path));
+    listings_->invalidate();
+  }
+  else if (msg.findAttribute("content-length") < msg.attributes().size())
+    msg.addBody(frame.body);
+  return msg;
+}
 //----< read a binary file from socket and save >--------------------
 /*
 * This function expects the sender to have already send a file message,
 * and when this function is running, continuosly send bytes until
-* fileSize bytes have been sent.
+* fileSize bytes have been sent. The socket receives them straight
+* into the file, in large blocks.
 */
 bool ClientHandler::readFile(const std::string& filename, size_t fileSize, Socket& socket)
 {
@@ -134,43 +390,27 @@ bool ClientHandler::readFile(const std::string& filename, size_t fileSize, Socke
   std::string filePath = FileSystem::Path::getPath(filename);
   superCreateDir(filePath);
 
-  std::string fqname = filename;
-  FileSystem::File file(fqname);
-  file.open(FileSystem::File::out, FileSystem::File::binary);
-  if (!file.isGood())
+  if (!socket.recvFile(filename, fileSize))
   {
-    /*
-    * This error handling is incomplete.  The client will continue
-    * to send bytes, but if the file can't be opened, then the server
-    * doesn't gracefully collect and dump them as it should.  That's
-    * an exercise left for students.
-    */
-    Show::write("\n\n  can't open file " + fqname);
+    Show::write("\n\n  can't save file " + filename);
     return false;
   }
+  return true;
+}
+//----< save a file body received in a frame >-----------------------
 
-  const size_t BlockSize = 2048;
-  Socket::byte buffer[BlockSize];
-
-  size_t bytesToRead;
-  while (true)
+bool ClientHandler::writeFile(const std::string& filename, std::string& content)
+{
+  superCreateDir(FileSystem::Path::getPath(filename));
+  FileSystem::File file(filename);
+  file.open(FileSystem::File::out, FileSystem::File::binary);
+  if (!file.isGood())
   {
-    if (fileSize > BlockSize)
-      bytesToRead = BlockSize;
-    else
-      bytesToRead = fileSize;
-
-    socket.recv(bytesToRead, buffer);
-
-    FileSystem::Block blk;
-    for (size_t i = 0; i < bytesToRead; ++i)
-      blk.push_back(buffer[i]);
-
-    file.putBlock(blk);
-    if (fileSize < BlockSize)
-      break;
-    fileSize -= BlockSize;
+    Show::write("\n\n  can't open file " + filename);
+    return false;
   }
+  if (content.size() > 0)
+    file.putBuffer(content.size(), &content[0]);
   file.close();
   return true;
 }
@@ -195,146 +435,348 @@ void recursiveRemoveDirectory(std::string path)
   // its sub-directories are deleted, so just delete it now
   FileSystem::Directory::remove(path);
 }
-//----< receiver functionality is defined by this function >---------
-
-void ClientHandler::operator()(Socket socket)
+//----< body of a FileDirs reply, name;date;type of each entry >-----
+/*
+* Files are the pages of the directory, named without .htm, then its
+* subdirectories. With noParent, only files no other file depends on.
+*/
+std::string ClientHandler::listFileDirs(const std::string& path, bool noParent)
 {
-  while (true)
+  std::string msgBody;
+
+  // one pass over the directory, by absolute path, since the
+  // current directory is shared by all handler threads
+  std::string absPath = rootPath_ + "\\" + path;
+  std::vector<FileSystem::DirEntry> entries = FileSystem::Directory::getEntries(absPath);
+
+  // add files & dirs to list, pages come from the pack if there is one
+  if (!state_->pack->loaded())
   {
-    HttpMessage msg = readMessage(socket);
-    if (connectionClosed_ || msg.bodyString() == "quit")
+    for (auto& entry : entries)
     {
-      Show::write("\n\n  clienthandler thread is terminating");
-      break;
+      if (entry.isDir || FileSystem::Path::getExt(entry.name) != "htm")
+        continue;
+      // remove htm externsion
+      std::string displayName = entry.name.substr(0, entry.name.size() - 4);
+      std::string origFilePath = path + "\\" + displayName;
+
+      if (!noParent || state_->depTable->depCount(origFilePath) == 0)
+        msgBody += (displayName + ";" + entry.date + ";f,");
     }
+  }
+  else
+  {
+    FileSystem::FileInfo packInfo(state_->pack->packFile());
+    for (auto page : state_->pack->files())
+    {
+      if (FileSystem::Path::getExt(page) != "htm" || FileSystem::Path::getPath(page) != path + "\\")
+        continue;
+      std::string origFilePath = page.substr(0, page.size() - 4);
+      std::string displayName = FileSystem::Path::getName(origFilePath);
+      if (!noParent || state_->depTable->depCount(origFilePath) == 0)
+        msgBody += (displayName + ";" + packInfo.date() + ";f,");
+    }
+  }
+  for (auto& entry : entries)
+  {
+    if (entry.isDir)
+      msgBody += (entry.name + ";" + entry.date + ";d,");
+  }
+  return msgBody;
+}
+//----< listing of a directory, from the cache if it's there >------
 
-    std::string fromAddr = msg.findValue("fromAddr");
-    HttpMessage sendMsg;
+std::string ClientHandler::cachedListing(const std::string& path, bool noParent)
+{
+  std::string key = path + (noParent ? "|NoParent" : "|");
+  std::string body;
+  if (listings_->find(key, body))
+    return body;
+
+  // a state taken after the generation is read is at least as new
+  size_t generation = listings_->generation();
+  state_ = shared_->snapshot();
+  body = listFileDirs(path, noParent);
+  listings_->store(key, body, generation);
+  return body;
+}
+//----< add a subtree to a page of a tree listing, depth first >-----
+/*
+* Each directory is followed by its contents, down to depth levels
+* below path, or all of them if depth is 0. Entries before the page
+* are walked but not added. Returns false once the page is full, so
+* the walk stops there.
+*/
+bool ClientHandler::listTree(const std::string& path, const std::string& prefix, size_t depth, bool noParent, TreePage& page)
+{
+  std::vector<std::string> entries = StringHelper::split(cachedListing(path, noParent));
+  for (auto& entry : entries)
+  {
+    if (page.count == page.offset + page.limit)
+    {
+      page.more = true;
+      return false;
+    }
+    if (page.count++ >= page.offset)
+      page.body += prefix + entry + ",";
 
-    std::string cmdStr = msg.findValue("Command");
-    if (cmdStr == "GetFileDirs")
+    size_t pos = entry.find(';');
+    bool isDir = entry.size() > 2 && entry.substr(entry.size() - 2) == ";d";
+    if (isDir && depth != 1 && pos != std::string::npos)
     {
-      std::string path = msg.findValue("Path");
-      std::string nopStr = msg.findValue("NoParent");
-      bool noParent = false;;
-      if (nopStr == "NoParent")
-        noParent = true;
+      std::string name = entry.substr(0, pos);
+      if (!listTree(path + "\\" + name, prefix + name + "\\", depth == 0 ? 0 : depth - 1, noParent, page))
+        return false;
+    }
+  }
+  return true;
+}
+//----< handle one message, replying on channel >-------------------
+/*
+* Channel is the client's Socket, or its Reactor::Connection. Either
+* way, messages of one client are handled one at a time, in order.
+*/
+template<typename Channel>
+void ClientHandler::handleMessage(HttpMessage& msg, Channel& channel)
+{
+  std::string fromAddr = msg.findValue("fromAddr");
+  HttpMessage sendMsg;
 
-      // body msg: files and dirs
-      std::string msgBody;
+  std::string cmdStr = msg.findValue("Command");
+  if (cmdStr == "GetFileDirs")
+  {
+    std::string path = msg.findValue("Path");
+    std::string nopStr = msg.findValue("NoParent");
+    bool noParent = false;;
+    if (nopStr == "NoParent")
+      noParent = true;
 
-      FileSystem::Directory::setCurrentDirectory(rootPath_ + "\\" + path);
-      std::string absPath = FileSystem::Directory::getCurrentDirectory();
+    // body msg: files and dirs, made again only after changes
+    std::string msgBody = cachedListing(path, noParent);
 
-      // add files & dirs to list
-      std::vector<std::string> files = FileSystem::Directory::getFiles(absPath, "*.htm");
-      for (auto file : files)
-      {
-        FileSystem::FileInfo fileInfo(absPath + "\\" + file);
-        std::string fullName = fileInfo.name();
-        // remove htm externsion
-        std::string displayName = fullName.substr(0, fullName.size() - 4);
-        std::string relaFilePath = path + "\\" + file;
-        std::string origFilePath = relaFilePath.substr(0, relaFilePath.size() - 4);
-
-        if (!noParent || depTable_.getDepFiles(origFilePath).size() == 0)
-          msgBody += (displayName + ";" + fileInfo.date() + ";f,");
-      }
-      std::vector<std::string> dirs = FileSystem::Directory::getDirectories(absPath);
-      for (auto dir : dirs)
-      {
-        if (dir == "." || dir == "..") continue;
+    sendMsg = makeMessage(1, msgBody, fromAddr);  //content-size is important!
+    sendMsg.addAttribute(HttpMessage::Attribute("Content", "FileDirs"));
+  }
+  else if (cmdStr == "GetTree")
+  {
+    std::string path = msg.findValue("Path");
+    bool noParent = (msg.findValue("NoParent") == "NoParent");
+    std::string depthStr = msg.findValue("Depth");
+    size_t depth = depthStr.size() > 0 ? Converter<size_t>::toValue(depthStr) : 0;
 
-        FileSystem::FileInfo fileInfo(absPath + "\\" + dir);
-        msgBody += (fileInfo.name() + ";" + fileInfo.date() + ";d,");
-      }
+    TreePage page;
+    std::string offsetStr = msg.findValue("Offset");
+    if (offsetStr.size() > 0)
+      page.offset = Converter<size_t>::toValue(offsetStr);
+    std::string limitStr = msg.findValue("Limit");
+    page.limit = limitStr.size() > 0 ? Converter<size_t>::toValue(limitStr) : 0;
+    if (page.limit == 0 || page.limit > TreePage::MaxLimit)
+      page.limit = TreePage::MaxLimit;
 
-      sendMsg = makeMessage(1, msgBody, fromAddr);  //content-size is important!
-      sendMsg.addAttribute(HttpMessage::Attribute("Content", "FileDirs"));
-    }
-    else if (cmdStr == "OpenFile")
+    // body msg: path;date;type of each entry, relative to path
+    listTree(path, "", depth, noParent, page);
+
+    sendMsg = makeMessage(1, page.body, fromAddr);
+    sendMsg.addAttribute(HttpMessage::Attribute("Content", "Tree"));
+    sendMsg.addAttribute(HttpMessage::Attribute("Path", path));
+    if (page.more)
+      sendMsg.addAttribute(HttpMessage::Attribute("Next", Converter<size_t>::toString(page.offset + page.limit)));
+  }
+  else if (cmdStr == "OpenFile")
+  {
+    std::string path = msg.findValue("Path");
+    
+    if (FileSystem::Path::getName(path) == "index")
     {
-      std::string path = msg.findValue("Path");
-      
-      if (path == ".\\index")
+      // index pages and search index, then pages the opened index
+      // links to, the client's page handler asks for other pages
+      // with GetPage when a link or search hit is followed
+      std::vector<std::string> files;
+      for (auto item : *state_->depTable)
+        files.push_back(item.first);
+      sendPublished("search.js", false, fromAddr, channel);
+      for (auto dir : Publisher::indexDirs(files))
       {
-        sendFile(rootPath_ + "\\" + "index.htm", "index.htm", true, fromAddr, socket);
-
-        for (auto item : depTable_)
-        {
-          std::string file = item.first;
-          std::cout << "\n file: " << file;
-          sendFile(rootPath_ + "\\" + file + ".htm", file + ".htm", false, fromAddr, socket);
-        }
+        std::string indexFile = dir + "index.htm";
+        if (indexFile != path + ".htm" && isPublished(indexFile))
+          sendPublished(indexFile, false, fromAddr, channel);
       }
-      else {
-        std::unordered_set<std::string> connectedFiles;
-        findConnectedFiles(connectedFiles, path);
+      sendPublished(path + ".htm", true, fromAddr, channel);
 
-        for (auto file : connectedFiles)
-        {
-          if (file == (path))
-            sendFile(rootPath_ + "\\" + file + ".htm", file + ".htm", true, fromAddr, socket);
-          else
-            sendFile(rootPath_ + "\\" + file + ".htm", file + ".htm", false, fromAddr, socket);
-        }
+      std::string dir = FileSystem::Path::getPath(path);
+      for (auto& file : files)
+      {
+        if (FileSystem::Path::getPath(file) == dir)
+          sendPage(file, false, fromAddr, channel);
       }
-
-      continue;
     }
-    else if (cmdStr == "DownloadCssJs")
-    {
-      std::string path = "template.css";
-      sendFile(rootPath_ + "\\" + path, path, false, fromAddr, socket);
-      path = "template.js";
-      sendFile(rootPath_ + "\\" + path, path, false, fromAddr, socket);
-      continue;
+    else {
+      for (auto file : state_->depGraph->connectedFiles(path))
+        sendPage(file, file == path, fromAddr, channel);
     }
-    else if (cmdStr == "DelFile")
-    {
-      std::string path = msg.findValue("Path");
-      // remove both source file and htm file
-      FileSystem::File::remove(rootPath_ + "\\" + path);
-      FileSystem::File::remove(rootPath_ + "\\" + path + ".htm");
 
-      sendMsg = makeMessage(1, "File Delete OK", fromAddr);
-      sendMsg.addAttribute(HttpMessage::Attribute("Content", "DelFile"));
-    }
-    else if (cmdStr == "DelDir")
-    {
-      std::string path = msg.findValue("Path");
+    return;
+  }
+  else if (cmdStr == "GetChunk")
+  {
+    std::string path = msg.findValue("Path");
+    std::string chunk = msg.findValue("Chunk");
+    if (chunk.size() == 0)
+      return;
+    std::string chunkFile = Publisher::chunkFile(path, Converter<size_t>::toValue(chunk));
+    if (isPublished(chunkFile) && sendPublished(chunkFile, false, fromAddr, channel))
+      return;
+    sendMsg = makeNoFileMessage(chunkFile, fromAddr);
+  }
+  else if (cmdStr == "GetPage")
+  {
+    // a page, index page or search index, not a source file, nor
+    // anything outside the published files
+    std::string path = msg.findValue("Path");
+    std::string ext = FileSystem::Path::getExt(path);
+    bool page = (ext == "htm" || ext == "js" || ext == "css")
+      && path.find("..") == std::string::npos && path.find(':') == std::string::npos;
+    if (page && isPublished(path) && sendPublished(path, false, fromAddr, channel))
+      return;
+    sendMsg = makeNoFileMessage(path, fromAddr);
+  }
+  else if (cmdStr == "GetDependents")
+  {
+    std::string path = msg.findValue("Path");
+
+    // body msg: files that transitively depend on path
+    std::string msgBody;
+    for (auto file : state_->depGraph->dependentFiles(path))
+      msgBody += (file + ",");
 
-      // remove entire directory
-      recursiveRemoveDirectory(rootPath_ + "\\" + path);
-      
-      sendMsg = makeMessage(1, "Dir Delete OK", fromAddr);
-      sendMsg.addAttribute(HttpMessage::Attribute("Content", "DelDir"));
+    sendMsg = makeMessage(1, msgBody, fromAddr);
+    sendMsg.addAttribute(HttpMessage::Attribute("Content", "Dependents"));
+  }
+  else if (cmdStr == "DownloadCssJs")
+  {
+    sendPublished("template.css", false, fromAddr, channel);
+    sendPublished("template.js", false, fromAddr, channel);
+    return;
+  }
+  else if (cmdStr == "DelFile")
+  {
+    std::string path = msg.findValue("Path");
+    // remove source file and its pages, a packed page is dropped
+    // from the pack index by removeDeps
+    FileSystem::File::remove(rootPath_ + "\\" + path);
+    FileSystem::File::remove(rootPath_ + "\\" + path + ".htm");
+    for (size_t chunk = 0; ; ++chunk)
+    {
+      if (!FileSystem::File::remove(rootPath_ + "\\" + Publisher::chunkFile(path, chunk)))
+        break;
     }
-    else if (cmdStr == "Publish")
+    removeDeps(path, false);
+    listings_->invalidate();
+
+    sendMsg = makeMessage(1, "File Delete OK", fromAddr);
+    sendMsg.addAttribute(HttpMessage::Attribute("Content", "DelFile"));
+  }
+  else if (cmdStr == "DelDir")
+  {
+    std::string path = msg.findValue("Path");
+
+    // remove entire directory
+    recursiveRemoveDirectory(rootPath_ + "\\" + path);
+    removeDeps(path, true);
+    listings_->invalidate();
+    
+    sendMsg = makeMessage(1, "Dir Delete OK", fromAddr);
+    sendMsg.addAttribute(HttpMessage::Attribute("Content", "DelDir"));
+  }
+  else if (cmdStr == "Publish")
+  {
+    PublishOptions options;
+    options.fast = (msg.findValue("Mode") == "Fast");
+    options.compactFolds = (msg.findValue("Folds") == "Compact");
+    std::string chunkLines = msg.findValue("ChunkLines");
+    if (chunkLines.size() > 0)
+      options.chunkLines = Converter<size_t>::toValue(chunkLines);
+    options.packed = (msg.findValue("Sink") == "Pack");
+    options.highlight = (msg.findValue("Highlight") == "On");
+
+    ClientHandler runner = jobRunner();
+    size_t id = jobs_->submit(rootPath_ + "|" + options.key(), outlet_, fromAddr,
+      [runner, options](PublishJob& job) mutable { runner.runPublish(job, options); });
+
+    sendMsg = makeMessage(1, "Publish queued", fromAddr);
+    sendMsg.addAttribute(HttpMessage::Attribute("Content", "PublishQueued"));
+    sendMsg.addAttribute(HttpMessage::Attribute("JobId", Converter<size_t>::toString(id)));
+  }
+  else {
+    return;
+  }
+
+  Show::write("\n\n  server sent\n" + sendMsg.toIndentedString());
+  sendMessage(sendMsg, channel);
+}
+//----< receiver functionality is defined by this function >---------
+
+void ClientHandler::operator()(Socket socket)
+{
+  outlet_ = std::make_shared<Outlet>();
+  outlet_->open([this, &socket](HttpMessage& msg) { sendMessage(msg, socket); });
+  while (true)
+  {
+    HttpMessage msg = readMessage(socket);
+    if (connectionClosed_ || msg.bodyString() == "quit")
     {
-      int argc = 5;
-      char* argv[6];
-      char path[256];
-      strcpy(path, rootPath_.c_str());
-
-      argv[0] = "";
-      argv[1] = path;
-      argv[2] = path;
-      argv[3] = "*.h";
-      argv[4] = "*.cpp";
-      //argv[5] = "/r";
-
-      publishCode(argc, argv);
-      sendMsg = makeMessage(1, "Publish OK", fromAddr);
-      sendMsg.addAttribute(HttpMessage::Attribute("Content", "Published"));
+      Show::write("\n\n  clienthandler thread is terminating");
+      break;
     }
-    else {
-      continue;
+    {
+      std::lock_guard<std::mutex> lock(outlet_->mutex());
+      state_ = shared_->snapshot();
+      handleMessage(msg, socket);
+      state_.reset();  // don't keep an old state alive between messages
     }
+    outlet_->flush();  // job messages queued during the reply
+  }
+  outlet_->close();  // socket goes away with this thread
+}
+//----< reactor worker handles one frame of a connection >-----------
+/*
+* This instance is shared by all workers and isn't changed. The first
+* frame of a connection gives it a copy of this instance, which then
+* handles all of its messages, as the copy a listener thread gets.
+*/
+void ClientHandler::operator()(Reactor::Connection& connection, Reactor::Frame& frame)
+{
+  std::shared_ptr<void>& context = connection.context();
+  if (!context)
+  {
+    // the outlet holds the connection weakly, the connection holds
+    // the handler, so a job can't outlive either by sending
+    std::shared_ptr<ClientHandler> handler = std::make_shared<ClientHandler>(*this);
+    std::weak_ptr<Reactor::Connection> weak = connection.shared_from_this();
+    handler->outlet_ = std::make_shared<Outlet>();
+    handler->outlet_->open([weak](HttpMessage& msg) {
+      Reactor::ConnectionPtr conn = weak.lock();
+      if (conn && !conn->closed())
+        postMessage(msg, *conn);
+    });
+    context = handler;
+  }
+  ClientHandler& handler = *std::static_pointer_cast<ClientHandler>(context);
 
-    Show::write("\n\n  server sent\n" + sendMsg.toIndentedString());
-    sendMessage(sendMsg, socket);
+  HttpMessage msg = handler.frameMessage(frame);
+  if (msg.attributes().size() == 0 || msg.bodyString() == "quit")
+  {
+    Show::write("\n\n  reactor connection is closing");
+    connection.close();
+    return;
   }
+  {
+    std::lock_guard<std::mutex> lock(handler.outlet_->mutex());
+    handler.state_ = shared_->snapshot();
+    handler.handleMessage(msg, connection);
+    handler.state_.reset();
+  }
+  handler.outlet_->flush();  // job messages queued during the reply
 }
 //----< factory for creating messages >------------------------------
 /*
@@ -373,72 +815,152 @@ HttpMessage ClientHandler::makeMessage(size_t n, const std::string& body, const
   return msg;
 }
 
-//----< send message using socket >----------------------------------
+//----< send message on channel >-----------------------------------
+/*
+* Header and body go out in one gathering send, without being
+* concatenated first.
+*/
+template<typename Channel>
+void ClientHandler::sendMessage(HttpMessage& msg, Channel& channel)
+{
+  std::string header = msg.headerString();
+  HttpMessage::Body& body = msg.body();
+  typename Channel::Buffers buffers;
+  buffers.push_back({ header.data(), header.size() });
+  if (body.size() > 0)
+    buffers.push_back({ &body[0], body.size() });
+  channel.sendv(buffers);
+}
+
+//----< send message from a job, without waiting for a slow client >-
+
+void ClientHandler::postMessage(HttpMessage& msg, Reactor::Connection& connection)
+{
+  std::string header = msg.headerString();
+  HttpMessage::Body& body = msg.body();
+  Reactor::Buffers buffers;
+  buffers.push_back({ header.data(), header.size() });
+  if (body.size() > 0)
+    buffers.push_back({ &body[0], body.size() });
+  connection.post(buffers);
+}
+
+//----< message telling receiver a file of fileSize bytes follows >--
+
+HttpMessage ClientHandler::makeFileMessage(const std::string& remotePath, size_t fileSize, bool openFile, const EndPoint& ep)
+{
+  HttpMessage msg = makeMessage(1, "", ep);
+  msg.addAttribute(HttpMessage::Attribute("Content", "File"));
+  msg.addAttribute(HttpMessage::Attribute("file", FileSystem::Path::getName(remotePath)));
+  msg.addAttribute(HttpMessage::Attribute("path", remotePath));
+  if (openFile)
+    msg.addAttribute(HttpMessage::Attribute("open", "true"));
+  else
+    msg.addAttribute(HttpMessage::Attribute("open", "false"));
+  msg.addAttribute(HttpMessage::Attribute("content-length", Converter<size_t>::toString(fileSize)));
+  return msg;
+}
 
-void ClientHandler::sendMessage(HttpMessage& msg, Socket& socket)
+//----< message telling receiver a file it asked for isn't published >
+/*
+* The client's page handler stops waiting for the file.
+*/
+HttpMessage ClientHandler::makeNoFileMessage(const std::string& remotePath, const EndPoint& ep)
 {
-  std::string msgString = msg.toString();
-  socket.send(msgString.size(), (Socket::byte*)msgString.c_str());
+  HttpMessage msg = makeMessage(1, "not published", ep);
+  msg.addAttribute(HttpMessage::Attribute("Content", "NoFile"));
+  msg.addAttribute(HttpMessage::Attribute("path", remotePath));
+  return msg;
 }
 
 //----< send file using socket >-------------------------------------
 /*
-* - Sends a message to tell receiver a file is coming.
-* - Then sends a stream of bytes until the entire file
-*   has been sent.
+* - Has the channel send a message to tell receiver a file is
+*   coming, then the file. Both go out in one call.
+* - Nothing is sent if the channel can't read the whole file.
 * - Sends in binary mode which works for either text or binary.
 */
-bool ClientHandler::sendFile(const std::string& localPath, const std::string& remotePath, bool openFile, const EndPoint& ep, Socket& socket)
+template<typename Channel>
+bool ClientHandler::sendFile(const std::string& localPath, const std::string& remotePath, bool openFile, const EndPoint& ep, Channel& channel)
 {
   // assumes that socket is connected
+  if (!FileSystem::File::exists(localPath))
+    return false;
   FileSystem::FileInfo fi(localPath);
   size_t fileSize = fi.size();
-  std::string sizeString = Converter<size_t>::toString(fileSize);
-  FileSystem::File file(localPath);
-  file.open(FileSystem::File::in, FileSystem::File::binary);
-  if (!file.isGood())
-    return false;
 
-  HttpMessage msg = makeMessage(1, "", ep);
-  msg.addAttribute(HttpMessage::Attribute("Content", "File"));
-  msg.addAttribute(HttpMessage::Attribute("file", FileSystem::Path::getName(localPath)));
-  msg.addAttribute(HttpMessage::Attribute("path", remotePath));
-  if (openFile)
-    msg.addAttribute(HttpMessage::Attribute("open", "true"));
-  else
-    msg.addAttribute(HttpMessage::Attribute("open", "false"));
-  msg.addAttribute(HttpMessage::Attribute("content-length", sizeString));
-  Show::write("\n\n  file sent\n" + msg.toIndentedString());
-  sendMessage(msg, socket);
-  const size_t BlockSize = 2048;
-  Socket::byte buffer[BlockSize];
-  while (true)
+  HttpMessage msg = makeFileMessage(remotePath, fileSize, openFile, ep);
+  if (!channel.sendFile(localPath, 0, fileSize, msg.headerString()))
   {
-    FileSystem::Block blk = file.getBlock(BlockSize);
-    if (blk.size() == 0)
-      break;
-    for (size_t i = 0; i < blk.size(); ++i)
-      buffer[i] = blk[i];
-    socket.send(blk.size(), buffer);
-    if (!file.isGood())
-      break;
+    Show::write("\n\n  can't send " + localPath);
+    return false;
   }
-  file.close();
+  Show::write("\n\n  file sent\n" + msg.toIndentedString());
   return true;
 }
 
-//----< find all files required by lazy download >------------------
+//----< send page of a file, with its first chunk if it has any >---
+/*
+* The first chunk goes before the shell page, so a page opened on
+* arrival can show code at once. Later chunks aren't sent: the
+* client asks for them with GetChunk as the page loads them, so the
+* transfer to open a page doesn't grow with the file.
+*/
+template<typename Channel>
+void ClientHandler::sendPage(const std::string& file, bool openFile, const EndPoint& ep, Channel& channel)
+{
+  std::string firstChunk = Publisher::chunkFile(file, 0);
+  bool chunked = isPublished(firstChunk);
+  if (chunked)
+    sendPublished(firstChunk, false, ep, channel);
+
+  sendPublished(file + ".htm", openFile, ep, channel);
+}
+
+//----< pack entry name of a published file, e.g., .\template.css >-
 
-void ClientHandler::findConnectedFiles(std::unordered_set<std::string>& files, const std::string& relativePath)
+static std::string packName(const std::string& remotePath)
 {
-  if (files.find(relativePath) != files.end())
-    return;
+  if (remotePath.find(".\\") == 0)
+    return remotePath;
+  return ".\\" + remotePath;
+}
+
+//----< is file in the pack, or in the code repository? >------------
 
-  files.insert(relativePath);
+bool ClientHandler::isPublished(const std::string& remotePath)
+{
+  PackIndex::Entry entry;
+  if (state_->pack->loaded())
+    return state_->pack->find(packName(remotePath), entry);
+  return FileSystem::File::exists(rootPath_ + "\\" + remotePath);
+}
+
+//----< send published file, out of the pack if there is one >-------
+/*
+* A packed page is sent from its offset in the pack, without copying
+* it out to a file first.
+*/
+template<typename Channel>
+bool ClientHandler::sendPublished(const std::string& remotePath, bool openFile, const EndPoint& ep, Channel& channel)
+{
+  const PackIndex& pack = *state_->pack;
+  if (!pack.loaded())
+    return sendFile(rootPath_ + "\\" + remotePath, remotePath, openFile, ep, channel);
 
-  // recusively find connected files
-  for (auto file : depTable_.getDepFiles(relativePath))
-    findConnectedFiles(files, file);
+  PackIndex::Entry entry;
+  if (!pack.find(packName(remotePath), entry) || !FileSystem::File::exists(pack.packFile()))
+    return false;
+
+  size_t fileSize = static_cast<size_t>(entry.size);
+  HttpMessage msg = makeFileMessage(remotePath, fileSize, openFile, ep);
+  if (!channel.sendFile(pack.packFile(), static_cast<size_t>(entry.offset), fileSize, msg.headerString()))
+  {
+    Show::write("\n\n  can't send " + remotePath + " from " + pack.packFile());
+    return false;
+  }
+  Show::write("\n\n  file sent\n" + msg.toIndentedString());
+  return true;
 }
 
 //----< progressively create directories >---------------------------
@@ -463,13 +985,228 @@ void ClientHandler::superCreateDir(const std::string& path)
   }
 }
 
-//----< call code publisher and return file map >--------------------
+//----< copy of this handler to run jobs on the PublishQueue thread >
+/*
+* The copy holds no queue, outlet or snapshot, so a queued job
+* doesn't keep them alive.
+*/
+ClientHandler ClientHandler::jobRunner()
+{
+  ClientHandler runner(*this);
+  runner.jobs_.reset();
+  runner.outlet_.reset();
+  runner.state_.reset();
+  return runner;
+}
+//----< parse one file alone and return the types it defines >------
+/*
+* Builds a fresh parser, so the file's AST and type table are kept
+* apart from any earlier analysis. The parser points the process
+* wide Repository at itself, so this runs only on the PublishQueue
+* thread, never while a publish parses.
+*/
+DepCache::Types ClientHandler::analyzeTypes(const std::string& fqFile)
+{
+  DepCache::Types types;
+  ConfigParseForCodeAnal configure;
+  Parser* pParser = configure.Build();
+  if (!pParser || !configure.Attach(fqFile))
+    return types;
+
+  Repository* pRepo = Repository::getInstance();
+  pRepo->package() = FileSystem::Path::getName(fqFile);
+  pRepo->language() = Language::Cpp;
+  pRepo->currentPath() = fqFile;
+  while (pParser->next())
+    pParser->parse();
+
+  TypeAnal typeAnal(rootPath_);
+  typeAnal.doTypeAnal();
+  for (auto type : pRepo->getTypeTable())
+    types.push_back(type);
+  return types;
+}
+
+//----< queue the dependency patch for an uploaded file >-----------
+/*
+* Only files the publisher analyzes, *.h and *.cpp, inside the code
+* repository take part. The patch is a job, since the file must be
+* parsed; more uploads of the file before it starts join it.
+*/
+void ClientHandler::updateDeps(const std::string& fqFile)
+{
+  std::string ext = FileSystem::Path::getExt(fqFile);
+  if (ext != "h" && ext != "cpp")
+    return;
+
+  std::string file = FileSystem::Path::getRelativeFromPathToFile(rootPath_, fqFile);
+  if (file.find(".\\") != 0)
+    return;  // not in code repository
+
+  ClientHandler runner = jobRunner();
+  jobs_->submit("deps|" + fqFile, nullptr, "",
+    [runner, fqFile](PublishJob&) mutable { runner.patchDeps(fqFile); });
+}
+//----< patch dependencies of an uploaded file, on the job thread >--
+/*
+* The file's own dependencies and the dependencies on types it
+* defines are recomputed; nothing else is. Every file the patch needs
+* is read first, against the current snapshot: the uploaded file is
+* scanned for both analyses and parsed, and the files that may use
+* its types are rescanned. The patch gets the results by value and
+* reads no files, so other writers wait only for the patch, and a
+* publish that replays it doesn't read them again. Which analysis to
+* patch is decided in the patch, from the state it is applied to; a
+* publish replaying it may have changed the mode.
+*/
+void ClientHandler::patchDeps(const std::string& fqFile)
+{
+  std::string file = FileSystem::Path::getRelativeFromPathToFile(rootPath_, fqFile);
+  IncludeAnal::Scan scan;
+  DepCache::Tokens tokens;
+  if (!IncludeAnal::scanLines(fqFile, scan) || !DepAnal::scanTokens(fqFile, tokens))
+    return;
+  DepCache::Types types = analyzeTypes(fqFile);
+  DepCache::Scans users = shared_->snapshot()->depCache->scanUsers(file, types);
+
+  shared_->update([fqFile, file, scan, tokens, types, users](AnalysisState& state) {
+    if (state.fastDeps)
+    {
+      IncludeAnal& includeAnal = AnalysisState::change(state.includeAnal);
+      includeAnal.updateFile(AnalysisState::change(state.depTable), fqFile, scan);
+    }
+    else
+    {
+      DepCache& depCache = AnalysisState::change(state.depCache);
+      depCache.updateFile(AnalysisState::change(state.depTable), file, tokens, types, users);
+    }
+    state.buildGraph();
+  });
+  listings_->invalidate();  // NoParent listings depend on the table
+}
+
+//----< drop dependencies and packed pages of a deleted file or dir >
+
+void ClientHandler::removeDeps(const std::string& path, bool isDir)
+{
+  // by value, the patch is applied again if a publish is running
+  shared_->update([path, isDir](AnalysisState& state) {
+    if (state.pack->loaded())
+    {
+      PackIndex& pack = AnalysisState::change(state.pack);
+      if (isDir)
+        pack.removeDir(packName(path));
+      else
+      {
+        pack.remove(packName(path) + ".htm");
+        for (size_t chunk = 0; ; ++chunk)
+        {
+          if (!pack.remove(packName(Publisher::chunkFile(path, chunk))))
+            break;
+        }
+      }
+    }
+
+    std::vector<std::string> files;
+    if (isDir)
+    {
+      std::string prefix = path + "\\";
+      for (auto& item : *state.depTable)
+      {
+        if (item.first.find(prefix) == 0)
+          files.push_back(item.first);
+      }
+    }
+    else
+      files.push_back(path);
+
+    if (files.size() == 0)
+      return;
+    DepTable& depTable = AnalysisState::change(state.depTable);
+    if (state.fastDeps)
+    {
+      IncludeAnal& includeAnal = AnalysisState::change(state.includeAnal);
+      for (auto& file : files)
+        includeAnal.removeFile(depTable, file);
+    }
+    else
+    {
+      DepCache& depCache = AnalysisState::change(state.depCache);
+      for (auto& file : files)
+        depCache.removeFile(depTable, file);
+    }
+    state.buildGraph();
+  });
+}
 
-void ClientHandler::publishCode(int argc, char* argv[])
+//----< send a message about a job to all clients waiting on it >----
+
+void ClientHandler::notify(PublishJob& job, const std::string& content, const std::string& body)
 {
+  for (auto& client : job.clients)
+  {
+    HttpMessage msg = makeMessage(1, body, client.second);
+    msg.addAttribute(HttpMessage::Attribute("Content", content));
+    msg.addAttribute(HttpMessage::Attribute("JobId", Converter<size_t>::toString(job.id)));
+    client.first->send(msg);
+  }
+}
+//----< run a publish job on the job thread >------------------------
+/*
+* Clients get a Progress message as each stage starts, its name in
+* the body, then Published, or PublishFailed with the reason.
+*/
+void ClientHandler::runPublish(PublishJob& job, const PublishOptions& options)
+{
+  int argc = 5;
+  char* argv[6];
+  char path[256];
+  strcpy(path, rootPath_.c_str());
+
+  argv[0] = "";
+  argv[1] = path;
+  argv[2] = path;
+  argv[3] = "*.h";
+  argv[4] = "*.cpp";
+  //argv[5] = "/r";
+
+  try
+  {
+    bool published = publishCode(argc, argv, options, [&](const std::string& stage) {
+      notify(job, "Progress", stage);
+    });
+    if (published)
+      notify(job, "Published", "Publish OK");
+    else
+      notify(job, "PublishFailed", "can't process " + rootPath_);
+  }
+  catch (std::exception& ex)
+  {
+    Show::write("\n\n  publish job failed: " + std::string(ex.what()));
+    shared_->cancelPublish();
+    notify(job, "PublishFailed", ex.what());
+  }
+}
+//----< call code publisher and return file map >--------------------
+/*
+* With options.fast set, parsing and type analysis are skipped and
+* the dependency table comes from include lines and using directives.
+* Pages then have no scope folding, since there is no AST.
+* With options.highlight set, and full analysis, dependency analysis
+* keeps the sources it reads, and the publisher highlights pages from
+* their token spans instead of reading the files again.
+* Results go into a new AnalysisState, which replaces the shared one
+* when the pages are written; clients read the old one until then.
+* progress is called with the name of each stage as it starts:
+* discovery, parse, type, dep and pages; fast runs skip parse and type.
+*/
+bool ClientHandler::publishCode(int argc, char* argv[], const PublishOptions& options, Progress progress)
+{
+  bool fast = options.fast;
   CodeAnalysisExecutive exec;
   bool succeeded = exec.ProcessCommandLine(argc, argv);
-  if (!succeeded) return;
+  if (!succeeded) return false;
+  size_t since = shared_->beginPublish();  // later patches are applied again
   exec.setDisplayModes();
   exec.startLogger(std::cout);
 
@@ -482,10 +1219,15 @@ void ClientHandler::publishCode(int argc, char* argv[])
   exec.showCommandLineArguments(argc, argv);
   Rslt::write("\n");
 
+  progress("discovery");
   exec.getSourceFiles();
-  exec.processSourceCode(true);
-  exec.complexityAnalysis();
-  exec.dispatchOptionalDisplays();
+  if (!fast)
+  {
+    progress("parse");
+    exec.processSourceCode(true);
+    exec.complexityAnalysis();
+    exec.dispatchOptionalDisplays();
+  }
   exec.flushLogger();
   Rslt::write("\n");
   std::ostringstream out;
@@ -493,24 +1235,70 @@ void ClientHandler::publishCode(int argc, char* argv[])
   out << "\n  " << std::setw(10) << "processed" << std::setw(6) << exec.numFiles() << " files";
   out << "\n    Code Analysis completed";
 
-  // do type analysis
-  TypeAnal typeAnal(exec.getAnalysisPath());
-  typeAnal.doTypeAnal();
+  TokenCache tokenCache;  // sources and token spans for the publisher
+  std::shared_ptr<AnalysisState> state = std::make_shared<AnalysisState>();
+  std::shared_ptr<DepTable> depTable;
+  if (fast)
+  {
+    // do include-graph dependency analysis
+    progress("dep");
+    std::shared_ptr<IncludeAnal> includeAnal = std::make_shared<IncludeAnal>(exec.getFileMap(), exec.getAnalysisPath());
+    includeAnal->doIncludeAnal();
+    depTable = std::make_shared<DepTable>(includeAnal->depTable());
+    state->includeAnal = includeAnal;
+  }
+  else
+  {
+    // do type analysis
+    progress("type");
+    TypeAnal typeAnal(exec.getAnalysisPath());
+    typeAnal.doTypeAnal();
 
-  // do dependency analysis
-  DepAnal depAnal(exec.getFileMap(), exec.getAnalysisPath());
-  depAnal.initDepTable();
-  depAnal.doDepAnal();
-  depTable_ = depAnal.depTable();
+    // do dependency analysis
+    progress("dep");
+    DepAnal depAnal(exec.getFileMap(), exec.getAnalysisPath());
+    depAnal.keepSources(options.highlight);
+    depAnal.initDepTable();
+    depAnal.doDepAnal();
+    depTable = std::make_shared<DepTable>(depAnal.depTable());
+    state->depCache = std::make_shared<DepCache>(depAnal.cache());
+    tokenCache = std::move(depAnal.tokenCache());
+  }
+  state->depTable = depTable;
+  state->fastDeps = fast;
+  state->buildGraph();
 
-  // publish code
-  Publisher publisher(depAnal.depTable(), exec.getAnalysisPath(), exec.getPublishDir());
-  publisher.doPublish();
+  // publish code, into a pack or to files next to the sources
+  progress("pages");
+  Publisher publisher(*depTable, exec.getAnalysisPath(), exec.getPublishDir());
+  if (options.compactFolds)
+    publisher.setFoldMode(Publisher::compactFolds);
+  publisher.setChunkLines(options.chunkLines);
+  if (tokenCache.size() > 0)
+    publisher.setTokenCache(&tokenCache);
+  if (options.packed)
+  {
+    ArchiveSink sink(packBase());
+    publisher.setSink(sink);
+    publisher.doPublish();
+    AnalysisState::change(state->pack).load(PackIndex::current(packBase()));
+  }
+  else
+  {
+    // handlers may still be sending out of a pack, it goes when they're done
+    for (auto version : PackIndex::versions(packBase()))
+      PackIndex::retire(PackIndex::versionFile(packBase(), version));
+    publisher.doPublish();
+    state->pack = std::make_shared<PackIndex>();
+  }
+  shared_->replace(state, since);
+  listings_->invalidate();
   out << "\n    Code Publish completed";
 
   exec.stopLogger();
   Rslt::write(out.str());
   Rslt::write("\n");
+  return true;
 }
 
 //----< test stub >--------------------------------------------------
@@ -528,14 +1316,28 @@ int main(int argc, char* argv[])
   try
   {
     SocketSystem ss;
-    SocketListener sl(8080, Socket::IP6);
     ClientHandler cp(msgQ);
     cp.ProcessCommandLine(argc, argv);
-    sl.start(cp);
-    
-    Show::write("\n -------------------\n  press key to exit: \n -------------------");
-    std::cout.flush();
-    std::cin.get();
+    auto waitForKey = []() {
+      Show::write("\n -------------------\n  press key to exit: \n -------------------");
+      std::cout.flush();
+      std::cin.get();
+    };
+
+    if (argc > 2 && std::string(argv[2]) == "/reactor")
+    {
+      // workers may wait on slow clients, so have more than cores
+      Reactor reactor(8080, 2 * std::thread::hardware_concurrency());
+      reactor.start(cp);
+      waitForKey();
+      reactor.stop();
+    }
+    else
+    {
+      SocketListener sl(8080, Socket::IP6);
+      sl.start(cp);
+      waitForKey();
+    }
   }
   catch (std::exception& exc)
   {
@@ -1,7 +1,7 @@
 #pragma once
 /////////////////////////////////////////////////////////////////////
 //  Server.h - Remote Code Publisher Server                        //
-//  ver 1.0                                                        //
+//  ver 2.17                                                       //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform remote code publisher           //
@@ -13,6 +13,31 @@ Package Operations:
 ==================
 This package defines a ClientHandle class for remote code publisher
 to handle requests from clients.
+Results of analysis, the dependency table and graph, and the pack
+index, live in one AnalysisState that all handlers share. Handlers
+read an immutable snapshot of it, without locking; a publish, upload
+or delete swaps in a changed copy, which the next message sees.
+Publish requests are queued as jobs and answered at once with a
+PublishQueued message holding the job id. One thread runs the jobs,
+sending a Progress message as each stage starts, and Published when
+pages are written. It doesn't wait on a client that is being served,
+or is slow to read: a message to a busy client is sent by its handler
+after the reply. Requests with the same options, made while a job
+waits to start, join that job instead of queuing another.
+GetFileDirs replies are cached by path and NoParent, until an upload,
+delete or publish, or a change a watcher thread sees in the code
+repository.
+GetTree lists a whole subtree, or its top Depth levels, in one reply,
+from the same cached listings. Entries are named relative to Path,
+each directory before its contents. Long trees come in pages of up to
+Limit entries from Offset; a reply with more to come has a Next
+attribute, the Offset of the next page.
+OpenFile of an index sends the search index and all index pages, the
+opened index, then the pages of files in its directory. Pages of
+other directories, reached from another index page or a search hit,
+are asked for with GetPage by the client's page handler, which serves
+opened pages to the browser, when the link is followed. GetPage and
+GetChunk reply NoFile for a file that isn't published.
 
 Public Interface:
 =================
@@ -21,20 +46,109 @@ SocketListener sl(8080, Socket::IP6);  // create socket listener instance
 ClientHandler cp(msgQ);                // create client handler instance
 cp.ProcessCommandLine(argc, argv);     // process command line arguments
 sl.start(cp);                          // start client handler
+Reactor reactor(8080, 8);              // or, with the /reactor option,
+reactor.start(cp);                     // handle frames on a worker pool
 
 Build Process:
 ==============
 Required files
 - Server.h, Server.cpp
 - Socket.h, Socket.cpp
+- Reactor.h, Reactor.cpp
 - HttpMessage.h, HttpMessage.cpp
 - CodePublisher.h, CodePublisher.cpp
 - ScopeTable.h, ScopeTable.cpp
+- PageSink.h, PageSink.cpp
+- PathTable.h, PathTable.cpp
 - DepAnal.h, DepAnal.cpp
+- DepGraph.h, DepGraph.cpp
+- TokenCache.h, TokenCache.cpp
+- IncludeAnal.h, IncludeAnal.cpp
 - AbstrSynTree.h, AbstrSynTree.cpp
 
 Maintenance History:
 ====================
+ver 2.17 : 19 Oct 2026
+- job messages never wait for a client's handler: they are queued
+  on its Outlet and sent by the handler after its reply, and a
+  Reactor connection takes them past HighWater
+ver 2.16 : 19 Oct 2026
+- added GetPage command sending one published page, index page or
+  search index, for links followed in the client's browser
+ver 2.15 : 19 Oct 2026
+- GetChunk of a chunk that isn't published replies NoFile
+ver 2.14 : 19 Oct 2026
+- an upload's dependency patch reads its files before taking the
+  writer lock, and picks the analysis from the state it patches
+ver 2.13 : 19 Oct 2026
+- OpenFile of an index also sends the pages its links point to
+ver 2.12 : 19 Oct 2026
+- packed pages go to versioned publish.<n>.pack files, appended to by
+  each publish; a pack is deleted once no snapshot refers to it
+- DelFile and DelDir drop packed pages from the snapshot's index
+ver 2.11 : 19 Oct 2026
+- AnalysisState parts are shared between states, a patch copies only
+  the parts it changes
+- patches made while a publish runs are applied again to its result
+ver 2.10 : 19 Oct 2026
+- OpenFile sends a chunked page with its first chunk only, clients
+  get later chunks with GetChunk
+ver 2.9 : 19 Oct 2026
+- uploaded sources are reparsed by a job on the PublishQueue thread,
+  the parser's Repository is process wide and a publish uses it too
+ver 2.8 : 19 Oct 2026
+- added GetTree command listing a subtree, to a depth, in pages
+ver 2.7 : 19 Oct 2026
+- GetFileDirs replies come from a ListingCache, cleared on changes
+  to the code repository
+ver 2.6 : 19 Oct 2026
+- GetFileDirs lists the directory by absolute path in one pass with
+  Directory::getEntries, instead of changing the current directory
+ver 2.5 : 19 Oct 2026
+- Publish runs as a background job, replying PublishQueued with a
+  JobId, then Progress per stage and Published when done
+ver 2.4 : 19 Oct 2026
+- analysis results moved from each ClientHandler copy into a shared
+  AnalysisState, read by snapshot and replaced atomically, so every
+  client sees the last publish
+ver 2.3 : 19 Oct 2026
+- messages go out with one gathering send of header and body, and
+  a file message header goes out with its file
+ver 2.2 : 19 Oct 2026
+- uploads are received with Socket::recvFile, in large blocks into
+  a preallocated file
+ver 2.1 : 19 Oct 2026
+- files and packed pages are sent with the channel's sendFile,
+  TransmitFile for a Socket and sendfile for a Linux reactor
+ver 2.0 : 19 Oct 2026
+- the /reactor option serves clients from an event driven Reactor
+  and a worker pool instead of a thread per connection; commands
+  are handled by the same code for both, per message
+ver 1.9 : 19 Oct 2026
+- Publish takes a Highlight attribute, Highlight:On makes pages from
+  the sources and token spans kept by dependency analysis
+ver 1.8 : 19 Oct 2026
+- OpenFile of an index sends the directory index pages and the
+  search index, not every page of the repository
+ver 1.7 : 19 Oct 2026
+- Publish takes a Sink attribute, Sink:Pack publishes all pages into
+  a single publish.pack file, pages are then sent out of the pack
+ver 1.6 : 19 Oct 2026
+- Publish takes a ChunkLines attribute to split long pages in chunks
+- added GetChunk command, OpenFile sends chunks after the shell page
+ver 1.5 : 19 Oct 2026
+- Publish takes a Folds attribute, Folds:Compact publishes pages
+  with fold ranges instead of duplicated <pre> blocks
+ver 1.4 : 19 Oct 2026
+- Publish takes a Mode attribute, Mode:Fast builds the dependency
+  table from include lines and using directives, without parsing
+ver 1.3 : 19 Oct 2026
+- uploads and DelFile/DelDir patch the dependency table in place
+ver 1.2 : 19 Oct 2026
+- added GetDependents command listing files that depend on a file
+ver 1.1 : 19 Oct 2026
+- OpenFile looks up connected files in a condensed DepGraph
+  built after each publish, instead of searching the DepTable
 ver 1.0 : 06 May 2017
 - first release
 
@@ -42,16 +156,255 @@ ver 1.0 : 06 May 2017
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
 #include "../Cpp11-BlockingQueue/Cpp11-BlockingQueue.h"
 #include "../Sockets/Sockets.h"
+#include "../Sockets/Reactor.h"
 #include "../HttpMessage/HttpMessage.h"
 #include "../CodePublisher/CodePublisher.h"
+#include "../Analyzer/DepGraph.h"
+#include "../Analyzer/IncludeAnal.h"
 
 using namespace Async;
 using namespace CodePublisher;
 using namespace CodeAnalysis;
 using EndPoint = std::string;
 
+/////////////////////////////////////////////////////////////////////
+// PublishOptions struct holds options given by Publish attributes
+
+struct PublishOptions
+{
+  bool fast = false;          // Mode:Fast, include-graph dependencies
+  bool compactFolds = false;  // Folds:Compact, fold ranges in pages
+  size_t chunkLines = 0;      // ChunkLines:<n>, chunked pages for longer sources
+  bool packed = false;        // Sink:Pack, pages in one pack file
+  bool highlight = false;     // Highlight:On, pages from analysis tokens
+
+  std::string key() const;    // same for the same options
+};
+
+/////////////////////////////////////////////////////////////////////
+// TreePage struct collects one page of a GetTree reply
+
+struct TreePage
+{
+  static const size_t MaxLimit = 4096;  // entries per page, at most
+
+  size_t offset = 0;   // entries to skip
+  size_t limit = 0;    // entries to add
+  size_t count = 0;    // entries walked so far
+  bool more = false;   // entries left after this page
+  std::string body;
+};
+
+/////////////////////////////////////////////////////////////////////
+// AnalysisState struct holds results of the last publish, patched
+// by uploads and deletes since
+// - parts are immutable and shared by the states made from each
+//   other; a patch replaces a part it changes with a changed copy
+
+struct AnalysisState
+{
+  template<typename Part>
+  using Shared = std::shared_ptr<const Part>;
+
+  Shared<DepTable> depTable = std::make_shared<DepTable>();
+  Shared<DepGraph> depGraph = std::make_shared<DepGraph>();
+  Shared<DepCache> depCache = std::make_shared<DepCache>();
+  Shared<IncludeAnal> includeAnal = std::make_shared<IncludeAnal>();
+  bool fastDeps = false;  // last publish used include-graph dependencies
+  Shared<PackIndex> pack = std::make_shared<PackIndex>();  // pages, if the last publish packed
+
+  // copy of a part, put in place of it, for a patch to change
+  template<typename Part>
+  static Part& change(Shared<Part>& part)
+  {
+    std::shared_ptr<Part> copy = std::make_shared<Part>(*part);
+    part = copy;
+    return *copy;
+  }
+  // new graph for the table, the old one isn't worth copying
+  void buildGraph()
+  {
+    std::shared_ptr<DepGraph> graph = std::make_shared<DepGraph>();
+    graph->build(*depTable);
+    depGraph = graph;
+  }
+};
+
+/////////////////////////////////////////////////////////////////////
+// SharedState class holds the current AnalysisState of the server
+// - readers take a snapshot, which stays valid and unchanged while
+//   they hold it, with an atomic load
+// - writers patch a copy and store it; the writer lock keeps two
+//   writers from losing each other's changes, readers never wait
+// - a publish builds its state from scratch; patches made while it
+//   runs are logged, and applied again to its state when it is put
+//   in place. Publishes run one at a time, on the PublishQueue thread.
+
+class SharedState
+{
+public:
+  using Snapshot = std::shared_ptr<const AnalysisState>;
+  using Patch = std::function<void(AnalysisState&)>;
+
+  SharedState() : state_(std::make_shared<AnalysisState>()) {}
+  Snapshot snapshot() const { return std::atomic_load(&state_); }
+
+  void update(Patch patch)
+  {
+    std::lock_guard<std::mutex> lock(writer_);
+    std::shared_ptr<AnalysisState> next = std::make_shared<AnalysisState>(*std::atomic_load(&state_));
+    patch(*next);
+    std::atomic_store(&state_, Snapshot(next));
+    ++generation_;
+    if (publishing_)
+      log_.push_back(std::make_pair(generation_, patch));
+  }
+  size_t beginPublish()
+  {
+    std::lock_guard<std::mutex> lock(writer_);
+    publishing_ = true;
+    log_.clear();
+    return generation_;
+  }
+  void cancelPublish()
+  {
+    std::lock_guard<std::mutex> lock(writer_);
+    publishing_ = false;
+    log_.clear();
+  }
+  void replace(const std::shared_ptr<AnalysisState>& state, size_t since)
+  {
+    std::lock_guard<std::mutex> lock(writer_);
+    for (auto& item : log_)
+    {
+      if (item.first > since)
+        item.second(*state);
+    }
+    log_.clear();
+    publishing_ = false;
+    std::atomic_store(&state_, Snapshot(state));
+    ++generation_;
+  }
+
+private:
+  Snapshot state_;
+  size_t generation_ = 0;  // count of changes
+  bool publishing_ = false;
+  std::vector<std::pair<size_t, Patch>> log_;  // patches since the publish began
+  std::mutex writer_;
+};
+
+/////////////////////////////////////////////////////////////////////
+// Outlet class lets a publish job send to a client it isn't serving
+// - the client's handler holds the lock while it handles a message,
+//   so job messages go out between replies, never inside one
+// - a job doesn't wait for the lock, its messages are queued and the
+//   handler sends them when it has replied
+// - once the client is gone, the outlet is closed and drops messages
+
+class Outlet
+{
+public:
+  using Send = std::function<void(HttpMessage&)>;
+
+  void open(Send send);
+  void close();
+  bool send(const HttpMessage& msg);
+  void flush();
+  std::mutex& mutex() { return mtx_; }
+
+private:
+  Send send_;                         // guarded by mtx_
+  std::mutex mtx_;                    // held while handling or sending
+  std::vector<HttpMessage> pending_;  // guarded by queueMtx_
+  bool open_ = false;                 // guarded by queueMtx_
+  std::mutex queueMtx_;
+};
+
+using OutletPtr = std::shared_ptr<Outlet>;
+
+/////////////////////////////////////////////////////////////////////
+// PublishJob struct is one publish run and the clients waiting on it
+
+struct PublishJob
+{
+  using Client = std::pair<OutletPtr, EndPoint>;
+
+  size_t id = 0;
+  std::string key;                       // requests with equal keys share a job
+  std::function<void(PublishJob&)> run;
+  std::vector<Client> clients;           // fixed once the job starts
+};
+
+/////////////////////////////////////////////////////////////////////
+// PublishQueue class runs publish jobs one at a time on its own thread
+// - every job that parses runs here, publishes and the reparse of an
+//   uploaded file, since parsers share the process wide Repository
+// - a request joins a queued job with the same key; a running job
+//   may have missed files uploaded since it started, so it isn't
+//   joined
+// - jobs still queued when the queue is destroyed are run first
+
+class PublishQueue
+{
+public:
+  using Run = std::function<void(PublishJob&)>;
+
+  PublishQueue();
+  PublishQueue(const PublishQueue&) = delete;
+  PublishQueue& operator=(const PublishQueue&) = delete;
+  ~PublishQueue();
+  size_t submit(const std::string& key, OutletPtr outlet, const EndPoint& ep, Run run);
+
+private:
+  void runJobs();
+
+  std::deque<PublishJob> jobs_;
+  size_t nextId_ = 1;
+  bool stop_ = false;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::thread thread_;
+};
+
+/////////////////////////////////////////////////////////////////////
+// ListingCache class holds GetFileDirs bodies, keyed by request
+// - any change clears it: uploads, deletes and publishes, and
+//   changes its watcher thread sees under the code repository
+// - a listing made while a change happened isn't stored, it may
+//   not show the change; generation tells
+
+class ListingCache
+{
+public:
+  ListingCache() {}
+  ListingCache(const ListingCache&) = delete;
+  ListingCache& operator=(const ListingCache&) = delete;
+  ~ListingCache();
+  bool find(const std::string& key, std::string& body);
+  size_t generation();
+  void store(const std::string& key, const std::string& body, size_t generation);
+  void invalidate();
+  void watch(const std::string& root);
+
+private:
+  std::unordered_map<std::string, std::string> listings_;
+  size_t generation_ = 0;
+  std::mutex mtx_;
+  HANDLE stop_ = NULL;  // signals the watcher to quit
+  std::thread watcher_;
+};
+
 /////////////////////////////////////////////////////////////////////
 // ClientHandler class
 /////////////////////////////////////////////////////////////////////
@@ -64,29 +417,68 @@ using EndPoint = std::string;
 // - I changed the SocketListener semantics to pass
 //   instances of this class by value for version 5.2.
 // - that means that all ClientHandlers need copy semantics.
+// - copies share one SharedState, so analysis results are the same
+//   for all clients, one PublishQueue and one ListingCache.
+// - a Reactor calls one shared instance per frame, which keeps a
+//   copy per connection in the connection's context.
 //
 class ClientHandler
 {
 public:
-  ClientHandler(BlockingQueue<HttpMessage>& msgQ) : msgQ_(msgQ) {}
+  ClientHandler(BlockingQueue<HttpMessage>& msgQ)
+    : msgQ_(msgQ), shared_(std::make_shared<SharedState>()), jobs_(std::make_shared<PublishQueue>()),
+      listings_(std::make_shared<ListingCache>()) {}
   void operator()(Socket socket);
+  void operator()(Reactor::Connection& connection, Reactor::Frame& frame);
   bool ProcessCommandLine(int argc, char* argv[]);
 
 private:
   bool connectionClosed_;
   BlockingQueue<HttpMessage>& msgQ_;
   std::string rootPath_;
-  DepTable depTable_;
+  std::shared_ptr<SharedState> shared_;
+  SharedState::Snapshot state_;  // what the current message is handled against
+  std::shared_ptr<PublishQueue> jobs_;
+  OutletPtr outlet_;             // this client's outlet, for publish jobs
+  std::shared_ptr<ListingCache> listings_;
+
+  using Progress = std::function<void(const std::string& stage)>;
+  bool publishCode(int argc, char* argv[], const PublishOptions& options, Progress progress);
+  void runPublish(PublishJob& job, const PublishOptions& options);
+  void notify(PublishJob& job, const std::string& content, const std::string& body);
+  void updateDeps(const std::string& fqFile);
+  void patchDeps(const std::string& fqFile);
+  ClientHandler jobRunner();
+  void removeDeps(const std::string& path, bool isDir);
+  std::string listFileDirs(const std::string& path, bool noParent);
+  std::string cachedListing(const std::string& path, bool noParent);
+  bool listTree(const std::string& path, const std::string& prefix, size_t depth, bool noParent, TreePage& page);
+  DepCache::Types analyzeTypes(const std::string& fqFile);
 
-  void publishCode(int argc, char* argv[]);
+  // Channel is a Socket or a Reactor::Connection, the members below
+  // only send on it
+  template<typename Channel>
+  void handleMessage(HttpMessage& msg, Channel& channel);
 
   HttpMessage readMessage(Socket& socket);
+  HttpMessage frameMessage(Reactor::Frame& frame);
   bool readFile(const std::string& filename, size_t fileSize, Socket& socket);
+  bool writeFile(const std::string& filename, std::string& content);
   HttpMessage makeMessage(size_t n, const std::string& body, const EndPoint& ep);
-  void sendMessage(HttpMessage& msg, Socket& socket);
-  bool sendFile(const std::string& localPath, const std::string& remotePath, bool openFile, const EndPoint& ep, Socket& socket);
+  template<typename Channel>
+  void sendMessage(HttpMessage& msg, Channel& channel);
+  static void postMessage(HttpMessage& msg, Reactor::Connection& connection);
+  template<typename Channel>
+  bool sendFile(const std::string& localPath, const std::string& remotePath, bool openFile, const EndPoint& ep, Channel& channel);
+  HttpMessage makeFileMessage(const std::string& remotePath, size_t fileSize, bool openFile, const EndPoint& ep);
+  HttpMessage makeNoFileMessage(const std::string& remotePath, const EndPoint& ep);
+  template<typename Channel>
+  void sendPage(const std::string& file, bool openFile, const EndPoint& ep, Channel& channel);
+  template<typename Channel>
+  bool sendPublished(const std::string& remotePath, bool openFile, const EndPoint& ep, Channel& channel);
+  bool isPublished(const std::string& remotePath);
+  std::string packBase() { return rootPath_ + "\\publish"; }
 
-  void findConnectedFiles(std::unordered_set<std::string>& files, const std::string& relativePath);
   void superCreateDir(const std::string& path);
 
   void showUsage();
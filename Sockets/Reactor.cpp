@@ -0,0 +1,866 @@
+/////////////////////////////////////////////////////////////////////
+//  Reactor.cpp - event driven connection engine                   //
+//  ver 1.6                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to support remote code publisher           //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+
+#include "Reactor.h"
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+
+#ifdef __linux__
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <csignal>
+
+static int lastError() { return errno; }
+static bool wouldBlock(int err) { return err == EAGAIN || err == EWOULDBLOCK || err == EINTR; }
+static void closeHandle(Reactor::Handle h) { ::close(static_cast<int>(h)); }
+static const int SendFlags = MSG_NOSIGNAL;  // a closed peer is an error, not a signal
+static const int MoreFlag = MSG_MORE;       // more follows, don't send a partial segment yet
+
+#include <iostream>
+
+struct Show  // Logger needs windows.h
+{
+  static void write(const std::string& msg) { std::clog << msg; }
+};
+
+#else
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "../Logger/Logger.h"
+#pragma comment(lib, "Ws2_32.lib")
+
+static int lastError() { return ::WSAGetLastError(); }
+static bool wouldBlock(int err) { return err == WSAEWOULDBLOCK; }
+static void closeHandle(Reactor::Handle h) { ::closesocket(static_cast<SOCKET>(h)); }
+static const int SendFlags = 0;
+static const int MoreFlag = 0;
+
+using Show = Logging::StaticLogger<1>;
+
+#endif
+
+const size_t Reactor::HighWater;
+const size_t Reactor::MaxHeader;
+const size_t Reactor::FileBlock;
+
+static const Reactor::Handle NoHandle = -1;
+static const uint64_t ListenerId = static_cast<uint64_t>(-1);  // epoll data of listener
+static const uint64_t WakerId = static_cast<uint64_t>(-2);     // epoll data of eventfd
+static const size_t RecvSize = 16 * 1024;
+
+//----< put socket in non-blocking mode >----------------------------
+
+static bool setNonBlocking(Reactor::Handle h)
+{
+#ifdef __linux__
+  int flags = ::fcntl(static_cast<int>(h), F_GETFL, 0);
+  return flags >= 0 && ::fcntl(static_cast<int>(h), F_SETFL, flags | O_NONBLOCK) == 0;
+#else
+  u_long on = 1;
+  return ::ioctlsocket(static_cast<SOCKET>(h), FIONBIO, &on) == 0;
+#endif
+}
+
+//----< send as many bytes as the socket takes, -1 on error >--------
+
+static long sendSome(Reactor::Handle h, const Reactor::byte* buffer, size_t bytes)
+{
+  int len = static_cast<int>((std::min)(bytes, static_cast<size_t>(1 << 30)));
+  long sent = static_cast<long>(::send(h, buffer, len, SendFlags));
+  if (sent < 0 && wouldBlock(lastError()))
+    return 0;
+  return sent < 0 ? -1 : sent;
+}
+
+//----< send buffers, after skip bytes, with one gathering call >---
+/*
+* Returns bytes sent, 0 if the socket is full, -1 on error.
+*/
+static long sendBuffers(Reactor::Handle h, const Reactor::Buffers& buffers, size_t skip, int flags)
+{
+  const size_t MaxBuffers = 64;
+#ifdef __linux__
+  std::vector<iovec> pieces;
+  for (auto& buffer : buffers)
+  {
+    if (skip >= buffer.size)
+    {
+      skip -= buffer.size;
+      continue;
+    }
+    iovec piece;
+    piece.iov_base = const_cast<Reactor::byte*>(buffer.data + skip);
+    piece.iov_len = buffer.size - skip;
+    skip = 0;
+    pieces.push_back(piece);
+    if (pieces.size() == MaxBuffers)
+      break;
+  }
+  msghdr msg = {};
+  msg.msg_iov = pieces.data();
+  msg.msg_iovlen = pieces.size();
+  long sent = static_cast<long>(::sendmsg(static_cast<int>(h), &msg, SendFlags | flags));
+#else
+  (void)flags;
+  std::vector<WSABUF> pieces;
+  for (auto& buffer : buffers)
+  {
+    if (skip >= buffer.size)
+    {
+      skip -= buffer.size;
+      continue;
+    }
+    WSABUF piece;
+    piece.buf = const_cast<Reactor::byte*>(buffer.data + skip);
+    piece.len = static_cast<ULONG>(buffer.size - skip);
+    skip = 0;
+    pieces.push_back(piece);
+    if (pieces.size() == MaxBuffers)
+      break;
+  }
+  DWORD bytes = 0;
+  long sent = -1;
+  if (::WSASend(static_cast<SOCKET>(h), pieces.data(), static_cast<DWORD>(pieces.size()), &bytes, 0, NULL, NULL) == 0)
+    sent = static_cast<long>(bytes);
+#endif
+  if (sent < 0 && wouldBlock(lastError()))
+    return 0;
+  return sent < 0 ? -1 : sent;
+}
+
+//----< value of the content-length attribute of a frame header >---
+
+static size_t contentLength(const std::string& header)
+{
+  size_t pos = 0;
+  while (pos < header.size())
+  {
+    size_t eol = header.find('\n', pos);
+    if (eol == std::string::npos)
+      eol = header.size();
+    size_t colon = header.find(':', pos);
+    if (colon < eol)
+    {
+      size_t first = header.find_first_not_of(" \t", pos);
+      size_t last = header.find_last_not_of(" \t", colon - 1);
+      if (first < colon && header.compare(first, last - first + 1, "content-length") == 0)
+        return static_cast<size_t>(std::strtoull(header.c_str() + colon + 1, nullptr, 10));
+    }
+    pos = eol + 1;
+  }
+  return 0;
+}
+
+//----< connection is created by the event thread on accept >-------
+
+Reactor::Connection::Connection(Reactor& reactor, Handle handle, size_t id)
+  : reactor_(reactor), handle_(handle), id_(id), closed_(false) {}
+
+//----< send buffers, queuing what the socket doesn't take at once >
+/*
+* Called with the connection locked. Returns false once the
+* connection is closed. Unless wait is false, blocks while more than
+* HighWater bytes are queued, so a slow client can't make the server
+* hold every page it asked for. The caller is a pool worker, which
+* stays blocked for as long as the client is slow.
+*/
+bool Reactor::Connection::put(std::unique_lock<std::mutex>& lock, const Buffers& buffers, int flags, bool wait)
+{
+  if (closed_.load() || closing_)
+    return false;
+  size_t total = 0, sent = 0;
+  for (auto& buffer : buffers)
+    total += buffer.size;
+  if (outPos_ == out_.size())
+  {
+    // nothing queued, so bytes can go straight to the socket
+    out_.clear();
+    outPos_ = 0;
+    while (sent < total)
+    {
+      long n = sendBuffers(handle_, buffers, sent, flags);
+      if (n < 0)
+        return false;  // event thread sees the error and closes
+      if (n == 0)
+        break;
+      sent += static_cast<size_t>(n);
+    }
+  }
+  if (sent == total)
+    return true;
+
+  size_t skip = sent;
+  for (auto& buffer : buffers)
+  {
+    if (skip >= buffer.size)
+    {
+      skip -= buffer.size;
+      continue;
+    }
+    out_.append(buffer.data + skip, buffer.size - skip);
+    skip = 0;
+  }
+  if (!writing_)
+  {
+    writing_ = true;
+    reactor_.watchWrite(*this, true);
+  }
+  if (wait)
+    drained_.wait(lock, [&]() { return closed_.load() || out_.size() - outPos_ <= HighWater; });
+  return !closed_.load();
+}
+
+//----< send buffer >------------------------------------------------
+
+bool Reactor::Connection::send(size_t bytes, const byte* buffer)
+{
+  Buffers buffers = { { buffer, bytes } };
+  return sendv(buffers);
+}
+
+//----< send buffers in order, without concatenating them >--------
+
+bool Reactor::Connection::sendv(const Buffers& buffers)
+{
+  std::unique_lock<std::mutex> lock(mtx_);
+  return put(lock, buffers, 0);
+}
+
+//----< send buffers, queuing past HighWater instead of waiting >---
+/*
+* For short messages from a thread that serves many clients, e.g.,
+* notices of a background job, so a slow client doesn't hold it up.
+*/
+bool Reactor::Connection::post(const Buffers& buffers)
+{
+  std::unique_lock<std::mutex> lock(mtx_);
+  return put(lock, buffers, 0, false);
+}
+
+//----< send terminator terminated string >--------------------------
+
+bool Reactor::Connection::sendString(const std::string& str, byte terminator)
+{
+  std::string buffer = str + terminator;
+  return send(buffer.size(), buffer.data());
+}
+
+//----< send head, then bytes of a file starting at offset >-------
+/*
+* Nothing is sent, and false is returned, if the file can't be read
+* or holds fewer than bytes bytes after offset, so a header never
+* promises bytes that can't be delivered.
+* While nothing is queued, Linux sendfile moves file bytes straight
+* to the socket, and head, sent with MSG_MORE, waits to go out in the
+* same segment as the start of the file. The rest is read in FileBlock
+* pieces and sent like any buffer. If the file shrinks during the
+* send, the client can't find the next message, so the connection is
+* closed.
+*/
+bool Reactor::Connection::sendFile(const std::string& fileSpec, size_t offset, size_t bytes, const std::string& head)
+{
+  std::ifstream in(fileSpec, std::ios::binary);
+  in.seekg(0, std::ios::end);
+  if (!in.good() || static_cast<size_t>(in.tellg()) < offset + bytes)
+    return false;
+
+  size_t sent = 0;
+  std::unique_lock<std::mutex> lock(mtx_);
+  Buffers buffers = { { head.data(), head.size() } };
+  if (!put(lock, buffers, bytes > 0 ? MoreFlag : 0))
+    return false;
+#ifdef __linux__
+  int fd = ::open(fileSpec.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0)
+  {
+    off_t pos = static_cast<off_t>(offset);
+    while (sent < bytes && outPos_ == out_.size())
+    {
+      ssize_t n = ::sendfile(static_cast<int>(handle_), fd, &pos, (std::min)(bytes - sent, static_cast<size_t>(1 << 30)));
+      if (n > 0)
+        sent += static_cast<size_t>(n);
+      else if (n < 0 && !wouldBlock(errno))
+      {
+        ::close(fd);
+        return false;  // event thread sees the error and closes
+      }
+      else
+        break;  // socket full, or end of file
+    }
+    ::close(fd);
+  }
+#endif
+  lock.unlock();
+  if (sent == bytes)
+    return !closed_.load();
+
+  in.seekg(static_cast<std::streamoff>(offset + sent));
+  std::vector<byte> block((std::min)(bytes - sent, FileBlock));
+  while (sent < bytes)
+  {
+    size_t n = (std::min)(bytes - sent, block.size());
+    in.read(&block[0], static_cast<std::streamsize>(n));
+    if (static_cast<size_t>(in.gcount()) != n)
+    {
+      close();
+      return false;
+    }
+    if (!send(n, &block[0]))
+      return false;
+    sent += n;
+  }
+  return true;
+}
+//----< close connection once its queued output is sent >------------
+
+void Reactor::Connection::close()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (closed_.load() || closing_)
+    return;
+  closing_ = true;
+  if (!writing_)
+  {
+    writing_ = true;
+    reactor_.watchWrite(*this, true);  // event thread closes when output is empty
+  }
+}
+
+//----< cut next complete frame from input, event thread only >-----
+/*
+* scanned_ remembers how far input was searched for the end of a
+* header, so a frame arriving in many reads isn't searched again
+* from the start each time.
+*/
+bool Reactor::Connection::nextFrame(Frame& frame)
+{
+  size_t end = in_.find("\n\n", scanned_ > 0 ? scanned_ - 1 : 0);
+  if (end == std::string::npos)
+  {
+    scanned_ = in_.size();
+    return false;
+  }
+  size_t bodyStart = end + 2;
+  size_t bodySize = contentLength(in_.substr(0, end + 1));
+  if (in_.size() - bodyStart < bodySize)
+  {
+    scanned_ = end;
+    return false;
+  }
+  frame.header = in_.substr(0, end + 1);
+  frame.body = in_.substr(bodyStart, bodySize);
+  in_.erase(0, bodyStart + bodySize);
+  scanned_ = 0;
+  return true;
+}
+
+//----< send queued output, event thread holds the lock >-----------
+
+bool Reactor::Connection::flush()
+{
+  while (outPos_ < out_.size())
+  {
+    long n = sendSome(handle_, out_.data() + outPos_, out_.size() - outPos_);
+    if (n < 0)
+      return false;
+    if (n == 0)
+      break;
+    outPos_ += static_cast<size_t>(n);
+  }
+  if (outPos_ == out_.size())
+  {
+    out_.clear();
+    outPos_ = 0;
+  }
+  else if (outPos_ >= HighWater)
+  {
+    out_.erase(0, outPos_);
+    outPos_ = 0;
+  }
+  drained_.notify_all();
+  return true;
+}
+
+//----< close socket and release waiting senders >------------------
+
+void Reactor::Connection::shutDown()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  closed_.store(true);
+  closeHandle(handle_);
+  handle_ = NoHandle;
+  frames_.clear();
+  out_.clear();
+  outPos_ = 0;
+  drained_.notify_all();
+}
+
+//----< reactor constructor, nothing runs until start >--------------
+
+Reactor::Reactor(size_t port, size_t workers)
+  : port_(port), numWorkers_(workers > 0 ? workers : 1),
+    listener_(NoHandle), poller_(NoHandle), waker_(NoHandle),
+    count_(0), stop_(false) {}
+
+//----< destructor stops event and worker threads >------------------
+
+Reactor::~Reactor()
+{
+  stop();
+}
+
+//----< listen on port and start event and worker threads >---------
+/*
+* The listener is an IPv6 socket that also accepts IPv4 clients,
+* like SocketListener(port, Socket::IP6).
+*/
+bool Reactor::start(Handler handler)
+{
+  handler_ = handler;
+  listener_ = static_cast<Handle>(::socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP));
+  if (listener_ == NoHandle)
+  {
+    Show::write("\n  reactor can't create listener");
+    return false;
+  }
+  int off = 0;
+  ::setsockopt(listener_, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&off), sizeof(off));
+#ifdef __linux__
+  int on = 1;
+  ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  ::signal(SIGPIPE, SIG_IGN);  // sendfile has no MSG_NOSIGNAL
+#endif
+
+  sockaddr_in6 addr = {};
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(static_cast<unsigned short>(port_));
+  if (::bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+    ::listen(listener_, SOMAXCONN) != 0 || !setNonBlocking(listener_))
+  {
+    Show::write("\n  reactor can't listen on port " + std::to_string(port_));
+    closeHandle(listener_);
+    listener_ = NoHandle;
+    return false;
+  }
+
+#ifdef __linux__
+  poller_ = ::epoll_create1(EPOLL_CLOEXEC);
+  waker_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = ListenerId;
+  ::epoll_ctl(poller_, EPOLL_CTL_ADD, listener_, &ev);
+  ev.data.u64 = WakerId;
+  ::epoll_ctl(poller_, EPOLL_CTL_ADD, waker_, &ev);
+#endif
+
+  for (size_t i = 0; i < numWorkers_; ++i)
+    workers_.push_back(std::thread(&Reactor::workerProc, this));
+  eventThread_ = std::thread(&Reactor::eventLoop, this);
+  Show::write("\n  reactor waiting for connections");
+  return true;
+}
+
+//----< close all connections and join threads >--------------------
+
+void Reactor::stop()
+{
+  if (stop_.exchange(true))
+    return;
+  wake();
+  if (eventThread_.joinable())
+    eventThread_.join();
+  for (size_t i = 0; i < workers_.size(); ++i)
+    ready_.enQ(nullptr);
+  for (auto& worker : workers_)
+    worker.join();
+  workers_.clear();
+  if (poller_ != NoHandle)
+    closeHandle(poller_);
+  if (waker_ != NoHandle)
+    closeHandle(waker_);
+  poller_ = waker_ = NoHandle;
+}
+
+//----< wake event thread so it sees stop_ >-------------------------
+/*
+* On Windows WSAPoll waits for a short time only, so there is nothing
+* to signal.
+*/
+void Reactor::wake()
+{
+#ifdef __linux__
+  if (waker_ != NoHandle)
+  {
+    uint64_t one = 1;
+    ssize_t n = ::write(static_cast<int>(waker_), &one, sizeof(one));
+    (void)n;
+  }
+#endif
+}
+
+//----< ask for, or stop asking for, writable events >--------------
+/*
+* Called with the connection locked. Writable events are only asked
+* for while output is queued, so an idle connection costs nothing.
+*/
+void Reactor::watchWrite(Connection& conn, bool on)
+{
+#ifdef __linux__
+  epoll_event ev = {};
+  ev.events = EPOLLIN | EPOLLRDHUP | (on ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+  ev.data.u64 = conn.id_;
+  ::epoll_ctl(poller_, EPOLL_CTL_MOD, conn.handle_, &ev);
+#else
+  (void)conn;
+  (void)on;  // WSAPoll set is rebuilt from writing_ on every pass
+#endif
+}
+
+//----< accept every pending connection >----------------------------
+
+void Reactor::acceptConnections()
+{
+  while (true)
+  {
+#ifdef __linux__
+    Handle handle = ::accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    Handle handle = static_cast<Handle>(::accept(listener_, nullptr, nullptr));
+    if (handle != NoHandle && !setNonBlocking(handle))
+    {
+      closeHandle(handle);
+      continue;
+    }
+#endif
+    if (handle == NoHandle)
+    {
+      if (!wouldBlock(lastError()))
+        Show::write("\n  reactor accept failed");
+      return;
+    }
+
+    ConnectionPtr conn = std::make_shared<Connection>(*this, handle, nextId_++);
+#ifdef __linux__
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = conn->id_;
+    ::epoll_ctl(poller_, EPOLL_CTL_ADD, handle, &ev);
+#endif
+    conns_[conn->id_] = conn;
+    ++count_;
+    Show::write("\n  reactor accepted connection");
+  }
+}
+
+//----< read what has arrived and hand frames to workers >----------
+/*
+* A connection is queued to the workers when it gets frames and no
+* worker has it, so its frames are handled one at a time, in order.
+*/
+void Reactor::readConnection(ConnectionPtr conn)
+{
+  if (conn->closed())
+    return;
+  byte buffer[RecvSize];
+  while (true)
+  {
+    long n = static_cast<long>(::recv(conn->handle_, buffer, static_cast<int>(RecvSize), 0));
+    if (n > 0)
+    {
+      conn->in_.append(buffer, static_cast<size_t>(n));
+      if (static_cast<size_t>(n) < RecvSize)
+        break;
+      continue;
+    }
+    if (n < 0 && wouldBlock(lastError()))
+      break;
+    closeConnection(conn);  // peer closed, or error
+    return;
+  }
+
+  bool queue = false;
+  Frame frame;
+  while (conn->nextFrame(frame))
+  {
+    std::lock_guard<std::mutex> lock(conn->mtx_);
+    conn->frames_.push_back(std::move(frame));
+    if (!conn->busy_)
+      queue = conn->busy_ = true;
+  }
+  if (queue)
+    ready_.enQ(conn);
+  if (conn->scanned_ > MaxHeader)
+  {
+    Show::write("\n  reactor closing connection with oversized header");
+    closeConnection(conn);
+  }
+}
+
+//----< send queued output, closing if the connection asked to >----
+
+void Reactor::writeConnection(ConnectionPtr conn)
+{
+  bool failed = false, closeNow = false;
+  {
+    std::lock_guard<std::mutex> lock(conn->mtx_);
+    if (conn->closed_.load())
+      return;
+    failed = !conn->flush();
+    if (!failed && conn->out_.empty())
+    {
+      conn->writing_ = false;
+      watchWrite(*conn, false);
+      closeNow = conn->closing_;
+    }
+  }
+  if (failed || closeNow)
+    closeConnection(conn);
+}
+
+//----< forget connection and close its socket >---------------------
+/*
+* Workers may still hold the connection; its sends then fail.
+*/
+void Reactor::closeConnection(ConnectionPtr conn)
+{
+  if (conns_.erase(conn->id_) == 0)
+    return;
+#ifdef __linux__
+  ::epoll_ctl(poller_, EPOLL_CTL_DEL, conn->handle_, nullptr);
+#endif
+  conn->shutDown();
+  --count_;
+  Show::write("\n  reactor closed connection");
+}
+
+//----< event thread waits on listener and all connections >--------
+
+void Reactor::eventLoop()
+{
+#ifdef __linux__
+  std::vector<epoll_event> events(256);
+  while (!stop_.load())
+  {
+    int n = ::epoll_wait(static_cast<int>(poller_), events.data(), static_cast<int>(events.size()), -1);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      Show::write("\n  reactor epoll_wait failed");
+      break;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+      uint64_t id = events[i].data.u64;
+      uint32_t flags = events[i].events;
+      if (id == ListenerId)
+      {
+        acceptConnections();
+        continue;
+      }
+      if (id == WakerId)
+      {
+        uint64_t count;
+        ssize_t r = ::read(static_cast<int>(waker_), &count, sizeof(count));
+        (void)r;
+        continue;
+      }
+      auto iter = conns_.find(static_cast<size_t>(id));
+      if (iter == conns_.end())
+        continue;  // closed earlier in this pass
+      ConnectionPtr conn = iter->second;
+      if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        readConnection(conn);
+      if ((flags & EPOLLOUT) && !conn->closed())
+        writeConnection(conn);
+    }
+  }
+#else
+  std::vector<WSAPOLLFD> fds;
+  std::vector<ConnectionPtr> polled;
+  while (!stop_.load())
+  {
+    fds.clear();
+    polled.clear();
+    WSAPOLLFD fd = {};
+    fd.fd = static_cast<SOCKET>(listener_);
+    fd.events = POLLRDNORM;
+    fds.push_back(fd);
+    for (auto& item : conns_)
+    {
+      std::lock_guard<std::mutex> lock(item.second->mtx_);
+      fd.fd = static_cast<SOCKET>(item.second->handle_);
+      fd.events = POLLRDNORM | (item.second->writing_ ? POLLWRNORM : 0);
+      fds.push_back(fd);
+      polled.push_back(item.second);
+    }
+    int n = ::WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), 10);
+    if (n == SOCKET_ERROR)
+    {
+      Show::write("\n  reactor WSAPoll failed");
+      break;
+    }
+    if (n == 0)
+      continue;
+    if (fds[0].revents & POLLRDNORM)
+      acceptConnections();
+    for (size_t i = 1; i < fds.size(); ++i)
+    {
+      ConnectionPtr conn = polled[i - 1];
+      if (fds[i].revents & (POLLRDNORM | POLLHUP | POLLERR))
+        readConnection(conn);
+      if ((fds[i].revents & POLLWRNORM) && !conn->closed())
+        writeConnection(conn);
+    }
+  }
+#endif
+
+  std::vector<ConnectionPtr> open;
+  for (auto& item : conns_)
+    open.push_back(item.second);
+  for (auto conn : open)
+    closeConnection(conn);
+  closeHandle(listener_);
+  listener_ = NoHandle;
+  Show::write("\n  reactor event thread stopping");
+}
+
+//----< worker handles one frame of a connection at a time >-------
+/*
+* After each frame the connection goes to the back of the queue if
+* it has more, so one busy client doesn't hold a worker.
+*/
+void Reactor::workerProc()
+{
+  while (true)
+  {
+    ConnectionPtr conn = ready_.deQ();
+    if (!conn)
+      break;  // stop sentinel
+
+    Frame frame;
+    {
+      std::lock_guard<std::mutex> lock(conn->mtx_);
+      if (conn->frames_.empty())
+      {
+        conn->busy_ = false;
+        continue;
+      }
+      frame = std::move(conn->frames_.front());
+      conn->frames_.pop_front();
+    }
+    try
+    {
+      handler_(*conn, frame);
+    }
+    catch (std::exception& ex)
+    {
+      Show::write("\n  reactor handler threw: " + std::string(ex.what()));
+    }
+
+    std::lock_guard<std::mutex> lock(conn->mtx_);
+    if (conn->frames_.empty() || conn->closed_.load())
+      conn->busy_ = false;
+    else
+      ready_.enQ(conn);
+  }
+}
+
+//----< test stub >--------------------------------------------------
+
+#ifdef TEST_REACTOR
+
+#include <iostream>
+#include <chrono>
+
+//----< client sends frames and checks the echoed bodies >---------
+
+bool echoClient(size_t port, size_t frames)
+{
+  Reactor::Handle h = static_cast<Reactor::Handle>(::socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP));
+  sockaddr_in6 addr = {};
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_loopback;
+  addr.sin6_port = htons(static_cast<unsigned short>(port));
+  if (::connect(h, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    return false;
+
+  bool ok = true;
+  for (size_t i = 0; i < frames && ok; ++i)
+  {
+    std::string body(1 + (i * 7919) % 5000, static_cast<char>('a' + i % 26));
+    std::string msg = "POST:Message\ncontent-length:" + std::to_string(body.size()) + "\n\n" + body;
+    ::send(h, msg.data(), static_cast<int>(msg.size()), 0);
+
+    std::string reply;
+    char buffer[4096];
+    while (reply.size() < body.size())
+    {
+      long n = static_cast<long>(::recv(h, buffer, sizeof(buffer), 0));
+      if (n <= 0)
+        break;
+      reply.append(buffer, static_cast<size_t>(n));
+    }
+    ok = (reply == body);
+  }
+  closeHandle(h);
+  return ok;
+}
+
+int main()
+{
+#ifndef __linux__
+  WSADATA wsaData;
+  ::WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+  std::cout << "\n  Testing Reactor";
+  std::cout << "\n =================\n";
+
+  Reactor reactor(8085, 4);
+  bool started = reactor.start([](Reactor::Connection& conn, Reactor::Frame& frame) {
+    conn.send(frame.body.size(), frame.body.data());
+  });
+  if (!started)
+    return 1;
+
+  const size_t Clients = 200, Frames = 50;
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> clients;
+  std::atomic<size_t> passed(0);
+  for (size_t i = 0; i < Clients; ++i)
+    clients.push_back(std::thread([&]() { if (echoClient(8085, Frames)) ++passed; }));
+  for (auto& client : clients)
+    client.join();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+
+  std::cout << "\n  " << passed.load() << " of " << Clients << " clients echoed "
+    << Frames << " frames in " << ms << " ms";
+  reactor.stop();
+  std::cout << "\n  open connections after stop: " << reactor.connections() << "\n\n";
+#ifndef __linux__
+  ::WSACleanup();
+#endif
+  return passed.load() == Clients ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,203 @@
+#pragma once
+/////////////////////////////////////////////////////////////////////
+//  Reactor.h - event driven connection engine                     //
+//  ver 1.6                                                        //
+//  Language:      Visual C++ 2015                                 //
+//  Platform:      Microsoft Surface, Windows 10                   //
+//  Application:   Used to support remote code publisher           //
+//  Author:        Kaiqi Zhang, Syracuse University                //
+//                 kzhang17@syr.edu                                //
+/////////////////////////////////////////////////////////////////////
+/*
+Package Operations:
+==================
+This package defines a Reactor class, an alternative to the thread
+per connection SocketListener. One event thread owns the listener
+and every accepted connection, all in non-blocking mode, and waits
+for them together: with epoll on Linux, with WSAPoll on Windows.
+Bytes read from a connection are cut into frames, each a header of
+"name:value" lines ended by an empty line, followed by as many body
+bytes as its content-length attribute gives, the way HttpMessages
+are sent. Complete frames are handed to a fixed pool of worker
+threads, which call the handler once per frame.
+Frames of one connection are handled in order, by one worker at a
+time, so a handler may keep per connection state in the context()
+of the connection without locking. Replies are sent with
+Connection::send, which writes what the socket takes at once and
+queues the rest for the event thread. A sender blocks when more
+than HighWater bytes are queued, until the client catches up. The
+sender is a pool worker, so as many slow clients as there are
+workers hold up frames of every other connection.
+Connection::sendFile sends part of a file. On Linux it uses
+sendfile, so file bytes don't pass through user buffers while the
+socket takes them; what it doesn't take is read in large blocks and
+queued like any other output.
+Connection::sendv sends a list of buffers, e.g., a message header
+and body, with one gathering call instead of concatenating them.
+Connection::post sends buffers without waiting at HighWater, for a
+thread other than the workers that mustn't wait on any one client.
+On Windows, winsock must already be loaded, e.g., by SocketSystem.
+Logger needs windows.h, so the Linux build writes its few messages
+to std::clog instead.
+
+Public Interface:
+=================
+Reactor reactor(8080, 8);                   // port, worker threads
+reactor.start([](Reactor::Connection& c, Reactor::Frame& frame) {
+  c.send(frame.body.size(), frame.body.data());
+});
+c.sendFile("a.htm", 0, 1024);              // file bytes 0 to 1023, from a handler
+reactor.connections();                      // open connections
+reactor.stop();                             // close all and join threads
+
+Build Process:
+==============
+Required files
+- Reactor.h, Reactor.cpp
+- Cpp11-BlockingQueue.h, Cpp11-BlockingQueue.cpp
+- Logger.h, Logger.cpp, on Windows only
+
+Maintenance History:
+====================
+ver 1.6 : 19 Oct 2026
+- added Connection::post, which queues past HighWater instead of
+  waiting for the client
+ver 1.5 : 19 Oct 2026
+- Connection::sendFile checks the file before sending the head, and
+  closes the connection if the file shrinks, instead of sending zeros
+ver 1.4 : 19 Oct 2026
+- HighWater, MaxHeader and FileBlock are defined out of class, they
+  are bound to references by std::min
+- the Linux build logs to std::clog instead of Logger
+ver 1.3 : 19 Oct 2026
+- Connection derives from enable_shared_from_this, so a handler can
+  keep a weak reference to send to it from other threads
+ver 1.2 : 19 Oct 2026
+- added Connection::sendv, and a head for Connection::sendFile,
+  corked with MSG_MORE on Linux so it shares a segment with the file
+ver 1.1 : 19 Oct 2026
+- added Connection::sendFile, with sendfile on Linux
+ver 1.0 : 19 Oct 2026
+- first release
+
+*/
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+#include "../Cpp11-BlockingQueue/Cpp11-BlockingQueue.h"
+
+/////////////////////////////////////////////////////////////////////
+// Reactor class accepts connections and frames their messages
+
+class Reactor
+{
+public:
+  using byte = char;
+  using Handle = std::intptr_t;  // SOCKET on Windows, fd on Linux
+
+  struct Buffer
+  {
+    const byte* data;
+    size_t size;
+  };
+  using Buffers = std::vector<Buffer>;
+
+  struct Frame
+  {
+    std::string header;  // attribute lines, each ended by '\n'
+    std::string body;
+  };
+
+  class Connection;
+  using ConnectionPtr = std::shared_ptr<Connection>;
+  using Handler = std::function<void(Connection&, Frame&)>;
+
+  static const size_t HighWater = 1024 * 1024;   // queued output a sender waits on
+  static const size_t MaxHeader = 64 * 1024;     // longer headers close the connection
+  static const size_t FileBlock = 256 * 1024;    // read size when a file can't go directly
+
+  Reactor(size_t port, size_t workers = 4);
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+  ~Reactor();
+
+  bool start(Handler handler);
+  void stop();
+  size_t connections() const { return count_.load(); }
+
+  /////////////////////////////////////////////////////////////////
+  // Connection class holds the buffers of one client
+  // - send and close may be called from any thread
+  // - shared_from_this gives its ConnectionPtr, e.g., to keep weakly
+
+  class Connection : public std::enable_shared_from_this<Connection>
+  {
+  public:
+    Connection(Reactor& reactor, Handle handle, size_t id);
+    bool send(size_t bytes, const byte* buffer);
+    bool sendv(const Buffers& buffers);
+    bool post(const Buffers& buffers);
+    bool sendString(const std::string& str, byte terminator = '\0');
+    bool sendFile(const std::string& fileSpec, size_t offset, size_t bytes, const std::string& head = "");
+    void close();
+    bool closed() const { return closed_.load(); }
+    size_t id() const { return id_; }
+    std::shared_ptr<void>& context() { return context_; }
+
+  private:
+    friend class Reactor;
+    bool put(std::unique_lock<std::mutex>& lock, const Buffers& buffers, int flags, bool wait = true);
+    bool nextFrame(Frame& frame);
+    bool flush();
+    void shutDown();
+
+    Reactor& reactor_;
+    Handle handle_;
+    size_t id_;
+    std::string in_;                 // event thread only
+    size_t scanned_ = 0;             // bytes of in_ searched for a header end
+    std::string out_;                // queued output, guarded by mtx_
+    size_t outPos_ = 0;
+    std::deque<Frame> frames_;       // guarded by mtx_
+    bool busy_ = false;              // queued to or run by a worker
+    bool closing_ = false;           // close once output is sent
+    bool writing_ = false;           // waiting for the socket to take output
+    std::atomic<bool> closed_;
+    std::mutex mtx_;
+    std::condition_variable drained_;
+    std::shared_ptr<void> context_;  // worker use only
+  };
+
+private:
+  void eventLoop();
+  void workerProc();
+  void acceptConnections();
+  void readConnection(ConnectionPtr conn);
+  void writeConnection(ConnectionPtr conn);
+  void closeConnection(ConnectionPtr conn);
+  void watchWrite(Connection& conn, bool on);
+  void wake();
+
+  size_t port_;
+  size_t numWorkers_;
+  Handler handler_;
+  Handle listener_;
+  Handle poller_;                  // epoll fd on Linux
+  Handle waker_;                   // eventfd on Linux
+  size_t nextId_ = 0;
+  std::unordered_map<size_t, ConnectionPtr> conns_;  // event thread only
+  std::atomic<size_t> count_;
+  std::atomic<bool> stop_;
+  std::thread eventThread_;
+  std::vector<std::thread> workers_;
+  Async::BlockingQueue<ConnectionPtr> ready_;  // connections with frames
+};
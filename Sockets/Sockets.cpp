@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////////
 // Sockets.cpp - C++ wrapper for Win32 socket api                      //
-// ver 5.2                                                             //
+// ver 5.8                                                             //
 // Jim Fawcett, CSE687 - Object Oriented Design, Spring 2016           //
 // CST 4-187, Syracuse University, 315 443-3948, jfawcett@twcny.rr.com //
 //---------------------------------------------------------------------//
@@ -18,6 +18,9 @@
 #include <memory>
 #include <functional>
 #include <exception>
+#include <algorithm>
+#include <cstring>
+#include <VersionHelpers.h>
 #include "../Utilities/Utilities.h"
 
 using Util = Utilities::StringHelper;
@@ -81,6 +84,7 @@ Socket::Socket(Socket&& s)
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
   hints.ai_protocol = s.hints.ai_protocol;
+  takeBuffer(s);
 }
 //----< transfer socket ownership with move assignment >---------------------
 
@@ -93,8 +97,19 @@ Socket& Socket::operator=(Socket&& s)
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
   hints.ai_protocol = s.hints.ai_protocol;
+  takeBuffer(s);
   return *this;
 }
+//----< buffered bytes belong to the socket, so they move with it >--------
+
+void Socket::takeBuffer(Socket& s)
+{
+  ring_.swap(s.ring_);
+  head_ = s.head_;
+  count_ = s.count_;
+  s.ring_.clear();
+  s.head_ = s.count_ = 0;
+}
 //----< get, set IP version >------------------------------------------------
 /*
 *  Note: 
@@ -173,8 +188,8 @@ bool Socket::send(size_t bytes, byte* buffer)
 */
 bool Socket::recv(size_t bytes, byte* buffer)
 {
-  size_t bytesRecvd = 0, bytesLeft = bytes;
-  byte* pBuf = buffer;
+  size_t bytesRecvd = drain(bytes, buffer), bytesLeft = bytes - bytesRecvd;
+  byte* pBuf = buffer + bytesRecvd;
   while (bytesLeft > 0)
   {
     bytesRecvd = ::recv(socket_, pBuf, bytesLeft, 0);
@@ -185,6 +200,188 @@ bool Socket::recv(size_t bytes, byte* buffer)
   }
   return true;
 }
+//----< send several buffers, in order, with gathering sends >--------------
+/*
+*  - the receiver gets the buffers as if they had been concatenated,
+*    but they aren't copied into one.  Usually one WSASend sends all.
+*  - doesn't return until all bytes have been sent
+*/
+bool Socket::sendv(const Buffers& buffers)
+{
+  std::vector<WSABUF> wsaBufs;
+  for (auto& buffer : buffers)
+  {
+    if (buffer.size == 0)
+      continue;
+    WSABUF wsaBuf;
+    wsaBuf.buf = const_cast<byte*>(buffer.data);
+    wsaBuf.len = (ULONG)buffer.size;
+    wsaBufs.push_back(wsaBuf);
+  }
+  size_t first = 0;
+  while (first < wsaBufs.size())
+  {
+    DWORD bytesSent = 0;
+    iResult = ::WSASend(socket_, &wsaBufs[first], (DWORD)(wsaBufs.size() - first), &bytesSent, 0, NULL, NULL);
+    if (iResult == SOCKET_ERROR || bytesSent == 0)
+      return false;
+    // skip buffers sent, the rest of a partly sent one goes next time
+    while (first < wsaBufs.size() && bytesSent >= wsaBufs[first].len)
+      bytesSent -= wsaBufs[first++].len;
+    if (first < wsaBufs.size())
+    {
+      wsaBufs[first].buf += bytesSent;
+      wsaBufs[first].len -= bytesSent;
+    }
+  }
+  return true;
+}
+//----< send head, then bytes of a file starting at offset >----------------
+/*
+*  - the file is opened and sized before anything is sent.  If it can't
+*    be read, or holds fewer than bytes bytes after offset, nothing is
+*    sent and false is returned, so the caller never promises bytes in
+*    a header that it can't deliver.
+*  - on server versions of Windows, files of TransmitMin bytes or more
+*    go with TransmitFile, which has the kernel send the file, so its
+*    bytes are never copied into user buffers.  head, if any, goes out
+*    in the same call.
+*  - workstation versions run only two TransmitFiles at a time and make
+*    the rest wait, so there, and for small files, the file is read in
+*    blocks and each block is sent with sendv, head with the first.
+*/
+bool Socket::sendFile(const std::string& fileSpec, size_t offset, size_t bytes, const std::string& head)
+{
+  const size_t MaxTransmit = 1 << 30;    // TransmitFile sends less than 2 GB per call
+  const size_t TransmitMin = 64 * 1024;  // smaller files are sent from a buffer
+  const size_t BlockSize = 64 * 1024;
+  static const bool serverSku = ::IsWindowsServer();
+
+  HANDLE hFile = ::CreateFileA(
+    fileSpec.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL
+  );
+  if (hFile == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER fileSize;
+  LARGE_INTEGER pos;
+  pos.QuadPart = (LONGLONG)offset;
+  if (!::GetFileSizeEx(hFile, &fileSize) || (size_t)fileSize.QuadPart < offset + bytes ||
+    !::SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN))
+  {
+    ::CloseHandle(hFile);
+    return false;
+  }
+
+  size_t sent = 0;
+  bool headSent = head.empty();
+  bool good = true;
+  if (serverSku && bytes >= TransmitMin)
+  {
+    while (good && sent < bytes)
+    {
+      pos.QuadPart = (LONGLONG)(offset + sent);
+      DWORD chunk = (DWORD)(std::min)(bytes - sent, MaxTransmit);
+      TRANSMIT_FILE_BUFFERS headBuffer;
+      ZeroMemory(&headBuffer, sizeof(headBuffer));
+      headBuffer.Head = (PVOID)head.data();
+      headBuffer.HeadLength = (DWORD)head.size();
+      good = ::SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN) &&
+        ::TransmitFile(socket_, hFile, chunk, 0, NULL, headSent ? NULL : &headBuffer, TF_USE_KERNEL_APC);
+      headSent = true;
+      sent += chunk;
+    }
+  }
+  else
+  {
+    std::vector<byte> block((std::min)(bytes, BlockSize) + 1);
+    while (good && (sent < bytes || !headSent))
+    {
+      DWORD want = (DWORD)(std::min)(bytes - sent, BlockSize);
+      DWORD got = 0;
+      if (want > 0 && (!::ReadFile(hFile, &block[0], want, &got, NULL) || got != want))
+      {
+        good = false;  // file shrank since it was sized
+        break;
+      }
+      Buffers buffers;
+      if (!headSent)
+        buffers.push_back({ head.data(), head.size() });
+      buffers.push_back({ &block[0], (size_t)got });
+      good = sendv(buffers);
+      headSent = true;
+      sent += got;
+    }
+  }
+  ::CloseHandle(hFile);
+  return good;
+}
+//----< receive bytes into a file, replacing it >---------------------------
+/*
+*  - the file is sized to bytes first, so the file system allocates it
+*    once.  Bytes are received into a page aligned 1 MB block, buffered
+*    bytes first, and each block is written with one WriteFile.
+*  - others may read or delete the file while it is received, e.g., a
+*    DelFile of it, instead of failing with a sharing violation.
+*  - if the file can't be written, the bytes are still received and
+*    dropped, so the next message is read correctly, and false is
+*    returned.  A file cut short by a closed connection is truncated.
+*/
+bool Socket::recvFile(const std::string& fileSpec, size_t bytes)
+{
+  const size_t BlockSize = 1024 * 1024;
+  HANDLE hFile = ::CreateFileA(
+    fileSpec.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL
+  );
+  bool good = (hFile != INVALID_HANDLE_VALUE);
+  LARGE_INTEGER pos;
+  if (good && bytes > 0)
+  {
+    pos.QuadPart = (LONGLONG)bytes;
+    if (::SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN))
+      ::SetEndOfFile(hFile);  // if this fails the file just grows as it is written
+    pos.QuadPart = 0;
+    good = (::SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN) != 0);
+  }
+
+  byte* buffer = (byte*)::VirtualAlloc(NULL, BlockSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  bool connected = (buffer != NULL);
+  size_t received = 0;
+  while (connected && received < bytes)
+  {
+    size_t want = (std::min)(bytes - received, BlockSize);
+    size_t got = drain(want, buffer);
+    while (got < want)
+    {
+      iResult = ::recv(socket_, buffer + got, (int)(want - got), 0);
+      if (iResult == 0 || iResult == SOCKET_ERROR)
+      {
+        connected = false;
+        break;
+      }
+      got += iResult;
+    }
+    DWORD written = 0;
+    if (good && got > 0)
+      good = ::WriteFile(hFile, buffer, (DWORD)got, &written, NULL) && written == got;
+    received += got;
+  }
+  if (buffer != NULL)
+    ::VirtualFree(buffer, 0, MEM_RELEASE);
+
+  if (hFile != INVALID_HANDLE_VALUE)
+  {
+    if (received < bytes)
+    {
+      pos.QuadPart = (LONGLONG)received;
+      if (::SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN))
+        ::SetEndOfFile(hFile);
+    }
+    ::CloseHandle(hFile);
+  }
+  return good && received == bytes;
+}
 //----< sends a terminator terminated string >-------------------------------
 /*
  *  Doesn't return until entire string has been sent
@@ -205,29 +402,69 @@ bool Socket::sendString(const std::string& str, byte terminator)
   ::send(socket_, &terminator, 1, 0);
   return true;
 }
+//----< read whatever has arrived into free space of circular buffer >------
+/*
+ * Blocks until at least one byte arrives. Returns number of bytes read,
+ * zero if the connection closed or failed.
+ */
+size_t Socket::fill()
+{
+  if (ring_.size() == 0)
+    ring_.resize(BufferSize);
+  if (count_ == 0)
+    head_ = 0;  // keeps free space in one piece
+  if (count_ == ring_.size())
+    return 0;
+  size_t tail = (head_ + count_) % ring_.size();
+  size_t space = (tail >= head_) ? ring_.size() - tail : head_ - tail;
+  iResult = ::recv(socket_, &ring_[tail], (int)space, 0);
+  if (iResult == 0 || iResult == SOCKET_ERROR)
+    return 0;
+  count_ += iResult;
+  return (size_t)iResult;
+}
+//----< move up to bytes buffered bytes to buffer, returns number moved >----
+
+size_t Socket::drain(size_t bytes, byte* buffer)
+{
+  size_t moved = 0;
+  while (moved < bytes && count_ > 0)
+  {
+    size_t run = (std::min)((std::min)(bytes - moved, count_), ring_.size() - head_);
+    std::memcpy(buffer + moved, &ring_[head_], run);
+    moved += run;
+    head_ = (head_ + run) % ring_.size();
+    count_ -= run;
+  }
+  return moved;
+}
 //----< receives terminator terminated string >------------------------------
 /*
  * Doesn't return until a terminator byte as been received.
- *
- * ToDo:
- * - needs reads of one byte to be replaced by bulk reads into a
- *   stream buffer to improve efficiency.
- * - That will require building a circular buffer.
- * - performance seems acceptable, so won't do this now
+ * - reads in bulk into the circular buffer and parses the string out
+ *   of it. Bytes after the terminator stay buffered for the next call.
  */
 std::string Socket::recvString(byte terminator)
 {
-  static const int buflen = 1;
-  char buffer[1];
   std::string str;
   while (true)
   {
-    iResult = ::recv(socket_, buffer, buflen, 0);
-    if (iResult == 0 || iResult == INVALID_SOCKET)
-      break;
-    if (buffer[0] == terminator)
+    while (count_ > 0)
+    {
+      size_t run = (std::min)(count_, ring_.size() - head_);
+      const byte* start = &ring_[head_];
+      const byte* found = (const byte*)std::memchr(start, terminator, run);
+      size_t take = found ? (size_t)(found - start) : run;
+      str.append(start, take);
+      if (found)
+        ++take;
+      head_ = (head_ + take) % ring_.size();
+      count_ -= take;
+      if (found)
+        return str;
+    }
+    if (fill() == 0)
       break;
-    str += buffer[0];
   }
   return str;
 }
@@ -245,6 +482,8 @@ size_t Socket::sendStream(size_t bytes, byte* pBuf)
 */
 size_t Socket::recvStream(size_t bytes, byte* pBuf)
 {
+  if (count_ > 0)
+    return drain(bytes, pBuf);
   return ::recv(socket_, pBuf, bytes, 0);
 }
 //----< returns bytes available in recv buffer >-----------------------------
@@ -253,7 +492,7 @@ size_t Socket::bytesWaiting()
 {
   unsigned long int ret;
   ::ioctlsocket(socket_, FIONREAD, &ret);
-  return (size_t)ret;
+  return (size_t)ret + count_;
 }
 //----< waits for server data, checking every timeToCheck millisec >---------
 
@@ -289,6 +528,7 @@ SocketConnecter::SocketConnecter(SocketConnecter&& s) : Socket()
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
   hints.ai_protocol = s.hints.ai_protocol;
+  takeBuffer(s);
 }
 //----< move assignment transfers ownership of Win32 socket_ member >--------
 
@@ -301,6 +541,7 @@ SocketConnecter& SocketConnecter::operator=(SocketConnecter&& s)
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
   hints.ai_protocol = s.hints.ai_protocol;
+  takeBuffer(s);
   return *this;
 }
 //----< destructor announces destruction if Verbose(true) >------------------
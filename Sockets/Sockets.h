@@ -2,7 +2,7 @@
 #define SOCKETS_H
 /////////////////////////////////////////////////////////////////////////
 // Sockets.h - C++ wrapper for Win32 socket api                        //
-// ver 5.2                                                             //
+// ver 5.8                                                             //
 // Jim Fawcett, CSE687 - Object Oriented Design, Spring 2016           //
 // CST 4-187, Syracuse University, 315 443-3948, jfawcett@twcny.rr.com //
 //---------------------------------------------------------------------//
@@ -39,6 +39,32 @@
 *
 *  Maintenance History:
 *  --------------------
+*  ver 5.8 : 19 Oct 26
+*  - recvFile shares the file for reading and deleting while it is
+*    received, instead of locking it.
+*  ver 5.7 : 19 Oct 26
+*  - sendFile checks the file before sending anything, instead of
+*    padding a missing or short file with zeros.
+*  - sendFile uses TransmitFile only for large files on server versions
+*    of Windows, which don't limit concurrent TransmitFiles; otherwise
+*    it reads the file in blocks and sends them with sendv.
+*  ver 5.6 : 19 Oct 26
+*  - added Socket::sendv, which sends a list of buffers with one WSASend
+*    instead of concatenating them first.
+*  - sendFile takes an optional head, e.g., a message header, that
+*    TransmitFile sends ahead of the file in the same call.
+*  ver 5.5 : 19 Oct 26
+*  - added Socket::recvFile, which receives a file body in 1 MB blocks
+*    into a file sized in advance, one WriteFile per block.
+*  ver 5.4 : 19 Oct 26
+*  - added Socket::sendFile, which sends part of a file with
+*    TransmitFile, so file bytes go from the file system cache to
+*    the network without passing through user buffers.
+*  ver 5.3 : 19 Oct 26
+*  - Socket reads into a circular buffer, in bulk. recvString parses
+*    lines out of it, and recv, recvStream, and bytesWaiting take
+*    buffered bytes first, so a message header costs about one recv
+*    call instead of one per byte.
 *  ver 5.2 : 20 Apr 17
 *  - changed SocketListener::start(CallObj& co) to pass its CallObj
 *    to each ClientHandler thread by value, instead of by reference.
@@ -105,10 +131,6 @@
 /*
 * ToDo:
 * - make SocketSystem a reference counted instance of Socket
-* - write buffered recv which efficiently returns string or line
-*   - reads and concatenates everything available into circular buffer
-*   - parses out first string or line and moves start of buffer pointer
-*     to begining of next
 * -----------------------------------------------------------------------
 *  Wait for The next items until Students have submitted their code
 * -----------------------------------------------------------------------
@@ -125,6 +147,7 @@
 #include <winsock2.h>     // Windows sockets, ver 2
 #include <WS2tcpip.h>     // support for IPv6 and other things
 #include <IPHlpApi.h>     // ip helpers
+#include <MSWSock.h>      // TransmitFile
 
 #include <vector>
 #include <string>
@@ -136,6 +159,7 @@
 
 #pragma warning(disable:4522)
 #pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Mswsock.lib")
 
 using namespace Logging;
 
@@ -162,6 +186,12 @@ class Socket
 public:
   enum IpVer { IP4, IP6 };
   using byte = char;
+  struct Buffer
+  {
+    const byte* data;
+    size_t size;
+  };
+  using Buffers = std::vector<Buffer>;
 
   // disable copy construction and assignment
   Socket(const Socket& s) = delete;
@@ -177,6 +207,9 @@ public:
   IpVer& ipVer();
   bool send(size_t bytes, byte* buffer);
   bool recv(size_t bytes, byte* buffer);
+  bool sendv(const Buffers& buffers);
+  bool sendFile(const std::string& fileSpec, size_t offset, size_t bytes, const std::string& head = "");
+  bool recvFile(const std::string& fileSpec, size_t bytes);
   size_t sendStream(size_t bytes, byte* buffer);
   size_t recvStream(size_t bytes, byte* buffer);
   bool sendString(const std::string& str, byte terminator='\0');
@@ -191,11 +224,22 @@ public:
   bool validState() { return socket_ != INVALID_SOCKET; }
 
 protected:
+  void takeBuffer(Socket& s);
+
   WSADATA wsaData;
   ::SOCKET socket_;
   struct addrinfo *result = NULL, *ptr = NULL, hints;
   int iResult;
   IpVer ipver_ = IP4;
+
+private:
+  static const size_t BufferSize = 64 * 1024;
+  size_t fill();
+  size_t drain(size_t bytes, byte* buffer);
+
+  std::vector<byte> ring_;  // received bytes not yet taken, allocated on first read
+  size_t head_ = 0;         // index of first buffered byte
+  size_t count_ = 0;        // number of buffered bytes
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,6 @@
 ﻿/////////////////////////////////////////////////////////////////////
 //  MainWindow.xaml.cs - GUI for remote code publisher             //
-//  ver 1.0                                                        //
+//  ver 1.2                                                        //
 //  Language:      Visual C++ 2015                                 //
 //  Platform:      Microsoft Surface, Windows 10                   //
 //  Application:   Used to perform code publisher                  //
@@ -29,6 +29,10 @@ Required files
 
 Maintenance History:
 ====================
+ver 1.2 : 19 Oct 2026
+- shows files a page asked for that the server hasn't published
+ver 1.1 : 19 Oct 2026
+- shows queued publish jobs and their progress in the status bar
 ver 1.0 : 06 May 2017
 - first release
 
@@ -384,6 +388,22 @@ namespace WpfGui
             {
                 statusBarItem.Content = "Status: " + msgArray[1] + " downloaded";
             }
+            else if (msgType == "NoFile")
+            {
+                statusBarItem.Content = "Status: " + msgArray[1] + " not published";
+            }
+            else if (msgType == "PublishQueued")
+            {
+                statusBarItem.Content = "Status: Publish job " + msgArray[1] + " queued";
+            }
+            else if (msgType == "Progress")
+            {
+                statusBarItem.Content = "Status: Publishing, " + msgArray[1];
+            }
+            else if (msgType == "PublishFailed")
+            {
+                statusBarItem.Content = "Status: Publish failed, " + msg.Substring(msgType.Length + 1);
+            }
             else if (msgType == "Published")
             {
                 statusBarItem.Content = "Status: All File Published";
@@ -181,7 +181,7 @@ namespace WpfGui
             if (wnd.shim != null)
                 wnd.shim.PostMessage(msg);
 
-            Console.Write("\n    If index file is requested, then all the files will be downloaded.");
+            Console.Write("\n    If an index file is requested, the index pages and the search index are downloaded.");
             Console.Write("\n");
         }
     }